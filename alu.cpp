@@ -0,0 +1,63 @@
+/*
+    VeMUlator - A Dreamcast Visual Memory Unit emulator for libretro
+    Copyright (C) 2018  Mahmoud Jaoune
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "alu.h"
+
+byte ALU_addFlags[0x20000];
+byte ALU_subFlags[0x20000];
+
+static bool ALU_ready = false;
+
+//Flags are computed arithmetically here, they match add8/sub8 bit for bit
+void ALU_init()
+{
+	if(ALU_ready) return;
+
+	for(int carry = 0; carry < 2; ++carry)
+	{
+		for(int op1 = 0; op1 < 256; ++op1)
+		{
+			for(int op2 = 0; op2 < 256; ++op2)
+			{
+				int index = (carry << 16) | (op1 << 8) | op2;
+
+				//Addition
+				int s = op1 + op2 + carry;
+				byte flags = 0;
+
+				if(s > 0xFF) flags |= ALU_CY;
+				if(((op1 & 0xF) + (op2 & 0xF) + carry) > 0xF) flags |= ALU_AC;
+				if((op1 ^ s) & (op2 ^ s) & 0x80) flags |= ALU_OV;	//Carry into bit 7 differs from carry out of it
+
+				ALU_addFlags[index] = flags;
+
+				//Subtraction (CY and AC are borrows)
+				int d = op1 - op2 - carry;
+				flags = 0;
+
+				if(d < 0) flags |= ALU_CY;
+				if(((op1 & 0xF) - (op2 & 0xF) - carry) < 0) flags |= ALU_AC;
+				if((op1 ^ op2) & (op1 ^ d) & 0x80) flags |= ALU_OV;
+
+				ALU_subFlags[index] = flags;
+			}
+		}
+	}
+
+	ALU_ready = true;
+}
@@ -0,0 +1,60 @@
+/*
+    VeMUlator - A Dreamcast Visual Memory Unit emulator for libretro
+    Copyright (C) 2018  Mahmoud Jaoune
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef _ALU_H_
+#define _ALU_H_
+
+#include "common.h"
+
+//Flags [0|0|0|0|0|O|A|C/B], same layout as add8/sub8
+#define ALU_CY 0x1
+#define ALU_AC 0x2
+#define ALU_OV 0x4
+
+//Flag tables, indexed by (carry << 16) | (op1 << 8) | op2
+extern byte ALU_addFlags[0x20000];
+extern byte ALU_subFlags[0x20000];
+
+struct VE_VMS_ALU_RESULT
+{
+    byte value;
+    byte flags;
+};
+
+///Fills the flag tables. Called once before the first instruction is executed.
+void ALU_init();
+
+///8-bit adder (op1 + op2 + carry), no allocation and no bit loop.
+inline VE_VMS_ALU_RESULT ALU_add(byte op1, byte op2, byte carry)
+{
+    VE_VMS_ALU_RESULT r;
+    r.value = (op1 + op2 + carry) & 0xFF;
+    r.flags = ALU_addFlags[(carry << 16) | (op1 << 8) | op2];
+    return r;
+}
+
+///8-bit subtractor (op1 - op2 - carry), no allocation and no bit loop.
+inline VE_VMS_ALU_RESULT ALU_sub(byte op1, byte op2, byte carry)
+{
+    VE_VMS_ALU_RESULT r;
+    r.value = (op1 - op2 - carry) & 0xFF;
+    r.flags = ALU_subFlags[(carry << 16) | (op1 << 8) | op2];
+    return r;
+}
+
+#endif // _ALU_H_
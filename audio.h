@@ -22,41 +22,32 @@
 #include <math.h>
 #include "libretro.h"
 #include "common.h"
-#include "cpu.h"
+#include "clock.h"
 #include "ram.h"
 
 class VE_VMS_AUDIO
 {
 public:
-    VE_VMS_AUDIO(VE_VMS_CPU *_cpu, VE_VMS_RAM *_ram);
+    VE_VMS_AUDIO(VE_VMS_CLOCK *_clock, VE_VMS_RAM *_ram);
     
     ~VE_VMS_AUDIO();
 
     void generateSignal(retro_audio_sample_t &audio_cb);
     
-    void setAudioFrequency(double f);
-
     void setT1(int b);
 
     void setT1C(int b);
     
     void setEnabled(bool e);
 
-    void runAudioCheck();
-    
-    int16_t *getSignal();
-
 private:
 	int T1LR_reg;
 	int T1LC_reg;
 	bool IsEnabled;
-	int T1LR_old;
-	
-	double frequency;	//This is supposed to be the CPU's frequency, but we have made the CPU's clock fixed
 	
-	int16_t *sampleArray;
+	uint32_t sampleRemainder;	//Fraction of a sample (In 1/FPS) carried to next frame
 	
-	VE_VMS_CPU *cpu;
+	VE_VMS_CLOCK *clock;
 	VE_VMS_RAM *ram;
 };
 
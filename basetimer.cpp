@@ -18,11 +18,11 @@
 
 #include "basetimer.h"
 
-VE_VMS_BASETIMER::VE_VMS_BASETIMER(VE_VMS_RAM *_ram, VE_VMS_INTERRUPTS *_intHandler, VE_VMS_CPU *_cpu)
+VE_VMS_BASETIMER::VE_VMS_BASETIMER(VE_VMS_RAM *_ram, VE_VMS_INTERRUPTS *_intHandler, VE_VMS_CLOCK *_clock)
 {
 	ram = _ram;
 	intHandler = _intHandler;
-	cpu = _cpu;
+	clock = _clock;
 	BTR = 0;
 }
 
@@ -30,61 +30,120 @@ VE_VMS_BASETIMER::~VE_VMS_BASETIMER()
 {
 }
 
-void VE_VMS_BASETIMER::runTimer() 
+///Runs timer for n cycles. BTR only grows between overflows (Where it is reset), so a source is raised
+///if its condition holds at the end, or if BTR overflowed on the way.
+void VE_VMS_BASETIMER::advance(int n)
 {
 	int BTCR_data = ram->readByte_RAW(BTCR);
 
-	bool BTStarted = (BTCR_data & 64) != 0;
+	if((BTCR_data & 64) == 0 || n <= 0) return;
+
 	bool Int0Enabled = (BTCR_data & 1) != 0;
 	bool Int1Enabled = (BTCR_data & 4) != 0;
-	int int1cycle;
+	int int1cycle = 32 << (2 * ((BTCR_data >> 4) & 3));
+
+	uint64_t full = 16383 * (uint64_t)CLOCK_MASTER_RATE;
+	uint64_t cycles = n;
+	uint64_t step = BT_STEP * (uint64_t)clock->getTicksPerCycle();
+	bool int1Reached = false;
+	bool overflowed = false;
 
-	int cycleControl = ((BTCR_data & 16) >> 4) | ((BTCR_data & 32) >> 4);
+	//Cycles until BTR goes over 16383 (It is reset in that cycle)
+	uint64_t untilReset = (full - BTR) / step + 1;
 
-	switch (cycleControl)
+	if(cycles >= untilReset)
 	{
-		case 0:
-			int1cycle = 32;
-			break;
-		case 1:
-			int1cycle = 128;
-			break;
-		case 2:
-			int1cycle = 512;
-			break;
-		case 3:
-			int1cycle = 2048;
-			break;
-		default:
-			int1cycle = 2048;
+		cycles -= untilReset;
+
+		//Then it counts from 0 again
+		uint64_t period = full / step + 1;
+		BTR = (cycles % period) * step;
+
+		int1Reached = true;
+		overflowed = true;
 	}
+	else BTR += cycles * step;
+
+	//Throw interrupt 1 source when cycle chosen is reached
+	if(BTR >= int1cycle * (uint64_t)CLOCK_MASTER_RATE) int1Reached = true;
 
-	if(BTStarted)
+	//Throw full (14-bit) overflow interrupt (Interrupt 0 source), or 6-bit when bit 7 is set
+	if((BTCR_data & 128) != 0 && BTR > 63 * (uint64_t)CLOCK_MASTER_RATE) overflowed = true;
+
+	if(int1Reached)
 	{
-		BTR += 32786.0 / cpu->getCurrentFrequency();
+		BTCR_data |= 8;
+		ram->writeByte_RAW(BTCR, BTCR_data);
+
+		if (Int1Enabled) 
+			intHandler->setINT3();
+	}
+
+	if(overflowed)
+	{
+		BTCR_data |= 2;
+		ram->writeByte_RAW(BTCR, BTCR_data);
+
+		if(Int0Enabled)
+			intHandler->setINT3();
+	}
+}
+
+///Interrupt 1 source is raised every cycle once BTR reaches its cycle, interrupt 0 source on overflow
+int VE_VMS_BASETIMER::cyclesUntilNextEvent()
+{
+	int BTCR_data = ram->readByte_RAW(BTCR);
+	if((BTCR_data & 64) == 0) return CYCLES_NEVER;
+
+	int cycles = CYCLES_NEVER;
 
-		//Throw interrupt 1 source when cycle chosen is reached
-		if(BTR >= int1cycle) 
-		{
-			BTCR_data |= 8;
-			ram->writeByte_RAW(BTCR, BTCR_data);
+	if((BTCR_data & 4) != 0) 
+	{
+		int int1cycle = 32 << (2 * ((BTCR_data >> 4) & 3));
+		cycles = cyclesUntil(int1cycle * (uint64_t)CLOCK_MASTER_RATE);
+	}
 
-			if (Int1Enabled) 
-				intHandler->setINT3();
+	if((BTCR_data & 1) != 0)
+	{
+		int overflowCycles = cyclesUntil(((BTCR_data & 128) != 0 ? 63 : 16383) * (uint64_t)CLOCK_MASTER_RATE + 1);
+		if(overflowCycles < cycles) cycles = overflowCycles;
+	}
 
-		}
+	return cycles;
+}
 
+///BTCR only changes when a source flag that is still clear gets set
+int VE_VMS_BASETIMER::cyclesUntilChange()
+{
+	int BTCR_data = ram->readByte_RAW(BTCR);
+	if((BTCR_data & 64) == 0) return CYCLES_NEVER;
 
-		if((BTR > 16383) || (BTR > 63 && ((BTCR_data & 128) != 0)))
-		{
-			//Throw full (14-bit) overflow interrupt (Interrupt 0 source)
-			BTCR_data |= 2;
-			ram->writeByte_RAW(BTCR, BTCR_data);
+	int cycles = CYCLES_NEVER;
 
-			if(Int0Enabled)
-				intHandler->setINT3();
+	if((BTCR_data & 8) == 0) 
+	{
+		int int1cycle = 32 << (2 * ((BTCR_data >> 4) & 3));
+		cycles = cyclesUntil(int1cycle * (uint64_t)CLOCK_MASTER_RATE);
+	}
 
-			if(BTR > 16383) BTR = 0;
-		}
+	if((BTCR_data & 2) == 0)
+	{
+		int overflowCycles = cyclesUntil(((BTCR_data & 128) != 0 ? 63 : 16383) * (uint64_t)CLOCK_MASTER_RATE + 1);
+		if(overflowCycles < cycles) cycles = overflowCycles;
 	}
+
+	return cycles;
+}
+
+///Cycles until BTR is at least level (Scaled), at least 1
+int VE_VMS_BASETIMER::cyclesUntil(uint64_t level)
+{
+	if(BTR >= level) return 1;
+
+	uint64_t step = BT_STEP * (uint64_t)clock->getTicksPerCycle();
+	uint64_t cycles = (level - BTR + step - 1) / step;
+
+	if(cycles > CYCLES_NEVER / 2) return CYCLES_NEVER / 2;
+
+	return (int)cycles;
 }
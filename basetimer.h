@@ -21,21 +21,34 @@
 
 #include "ram.h"
 #include "interrupts.h"
-#include "cpu.h"
+#include "clock.h"
+
+//BTR counts 32786 / frequency each cycle, it is kept in master clock ticks so a cycle adds BT_STEP * ticks per cycle
+#define BT_STEP 32786
 
 class VE_VMS_BASETIMER
 {
 public:
-    VE_VMS_BASETIMER(VE_VMS_RAM *_ram, VE_VMS_INTERRUPTS *_intHandler, VE_VMS_CPU *_cpu);
+    VE_VMS_BASETIMER(VE_VMS_RAM *_ram, VE_VMS_INTERRUPTS *_intHandler, VE_VMS_CLOCK *_clock);
     ~VE_VMS_BASETIMER();
 
-    void runTimer();
+    //Runs timer for n cycles
+    void advance(int n);
+
+    //Cycles until timer raises an interrupt (At least 1), CYCLES_NEVER if it cannot
+    int cyclesUntilNextEvent();
+
+    //Cycles until software may read something else from BTCR, CYCLES_NEVER if only software changes it
+    int cyclesUntilChange();
     
 private:
-	double BTR;    //14-bit
+	uint64_t BTR;       //14-bit, scaled by CLOCK_MASTER_RATE
 	VE_VMS_RAM *ram;
 	VE_VMS_INTERRUPTS *intHandler;
-	VE_VMS_CPU *cpu;
+	VE_VMS_CLOCK *clock;
+
+	//Cycles until BTR reaches level (Scaled)
+	int cyclesUntil(uint64_t level);
 };
 
 #endif // _BASETIMER_H_
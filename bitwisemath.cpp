@@ -203,3 +203,15 @@ int int2BCD(int dec)
 
 	return bcd;
 }
+
+///Returns number of lowest set bit (v must not be 0)
+int lowestBit(uint32_t v)
+{
+#ifdef __GNUC__
+	return __builtin_ctz(v);
+#else
+	int n = 0;
+	for(; (v & 1) == 0; v >>= 1) n++;
+	return n;
+#endif
+}
@@ -40,4 +40,7 @@ byte toSigned8(byte op);
 ///Converts normal number byteo BCD
 int int2BCD(int dec);
 
+///Returns number of lowest set bit (v must not be 0)
+int lowestBit(uint32_t v);
+
 #endif // _BITWISEMATH_H_
@@ -0,0 +1,71 @@
+/*
+    VeMUlator - A Dreamcast Visual Memory Unit emulator for libretro
+    Copyright (C) 2018  Mahmoud Jaoune
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "block.h"
+
+VE_VMS_BLOCKCACHE::VE_VMS_BLOCKCACHE()
+{
+	for(int bank = 0; bank < 2; ++bank)
+		for(size_t i = 0; i < ICACHE_PAGE_COUNT; ++i)
+			pages[bank][i] = NULL;
+
+	stats.blocks = 0;
+	stats.instructions = 0;
+	stats.fused = 0;
+	stats.cycles = 0;
+	stats.built = 0;
+}
+
+VE_VMS_BLOCKCACHE::~VE_VMS_BLOCKCACHE()
+{
+	flush();
+
+	for(int bank = 0; bank < 2; ++bank)
+		for(size_t i = 0; i < ICACHE_PAGE_COUNT; ++i)
+			delete []pages[bank][i];
+}
+
+///Allocates a page of empty slots
+VE_VMS_BLOCK **VE_VMS_BLOCKCACHE::newPage(byte bank, size_t page)
+{
+	VE_VMS_BLOCK **slots = new VE_VMS_BLOCK*[ICACHE_PAGE_SIZE];
+
+	for(size_t i = 0; i < ICACHE_PAGE_SIZE; ++i)
+		slots[i] = NULL;
+
+	pages[bank][page] = slots;
+	return slots;
+}
+
+///Deletes all blocks
+void VE_VMS_BLOCKCACHE::flush()
+{
+	for(int bank = 0; bank < 2; ++bank)
+	{
+		for(size_t i = 0; i < ICACHE_PAGE_COUNT; ++i)
+		{
+			if(pages[bank][i] == NULL) continue;
+
+			for(size_t j = 0; j < ICACHE_PAGE_SIZE; ++j)
+			{
+				delete pages[bank][i][j];
+				pages[bank][i][j] = NULL;
+			}
+		}
+	}
+}
@@ -0,0 +1,96 @@
+/*
+    VeMUlator - A Dreamcast Visual Memory Unit emulator for libretro
+    Copyright (C) 2018  Mahmoud Jaoune
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef _BLOCK_H_
+#define _BLOCK_H_
+
+#include "common.h"
+#include "icache.h"
+
+//Longest superblock in instructions
+#define BLOCK_MAX_LENGTH 32
+
+//Handler of two fused instructions (Superinstruction), called with PC pointing after both
+typedef void (VE_VMS_CPU::*VE_VMS_FUSED_HANDLER)(const VE_VMS_INSTRUCTION &first, const VE_VMS_INSTRUCTION &second);
+
+//One dispatch inside a superblock, either a single instruction or a fused pair
+struct VE_VMS_BLOCK_OP
+{
+    VE_VMS_HANDLER handler;         //Handler of first instruction
+    VE_VMS_FUSED_HANDLER fused;     //NULL when not fused
+    const VE_VMS_INSTRUCTION *first;
+    const VE_VMS_INSTRUCTION *second;
+    byte length;                    //Bytes of both instructions
+    byte count;                     //Instructions (1 or 2)
+    byte cycles;                    //Cycles of both instructions
+};
+
+//Straight-line code, from its address up to the next branch (Or BLOCK_MAX_LENGTH instructions)
+struct VE_VMS_BLOCK
+{
+    unsigned generation;            //Instruction cache generation this block was built from
+    int opCount;
+    int instructionCount;
+    int cycles;
+    int cyclesAt[BLOCK_MAX_LENGTH + 1];     //Cycles of first n instructions
+    uint16_t last;                  //Address of final instruction
+    bool loopBranch;                //Final instruction is a branch an idle loop may end in
+    VE_VMS_BLOCK_OP ops[BLOCK_MAX_LENGTH];
+};
+
+//Execution statistics of superblocks
+struct VE_VMS_BLOCK_STATS
+{
+    unsigned long blocks;           //Blocks dispatched
+    unsigned long instructions;     //Instructions executed in blocks
+    unsigned long fused;            //Instructions executed as part of a superinstruction
+    unsigned long cycles;           //Cycles of instructions executed in blocks
+    unsigned long built;            //Blocks translated
+};
+
+class VE_VMS_BLOCKCACHE
+{
+public:
+    VE_VMS_BLOCKCACHE();
+    ~VE_VMS_BLOCKCACHE();
+
+    ///Returns block slot of address in bank (NULL when not built yet)
+    VE_VMS_BLOCK *&getBlock(byte bank, size_t address)
+    {
+        address &= 0xFFFF;
+
+        VE_VMS_BLOCK **page = pages[bank][address / ICACHE_PAGE_SIZE];
+        if(page == NULL) page = newPage(bank, address / ICACHE_PAGE_SIZE);
+
+        return page[address % ICACHE_PAGE_SIZE];
+    }
+
+    ///Deletes all blocks
+    void flush();
+
+    VE_VMS_BLOCK_STATS stats;
+
+private:
+    //Block slots, pages are allocated on first use
+    VE_VMS_BLOCK **pages[2][ICACHE_PAGE_COUNT];
+
+    //Allocates a page of empty slots
+    VE_VMS_BLOCK **newPage(byte bank, size_t page);
+};
+
+#endif // _BLOCK_H_
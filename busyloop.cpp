@@ -0,0 +1,70 @@
+/*
+    VeMUlator - A Dreamcast Visual Memory Unit emulator for libretro
+    Copyright (C) 2018  Mahmoud Jaoune
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "busyloop.h"
+#include "log.h"
+
+//Loops listed by logStats
+#define BUSYLOOP_REPORT 8
+
+VE_VMS_BUSYLOOPS::VE_VMS_BUSYLOOPS()
+{
+	for(int i = 0; i < BUSYLOOP_CACHE_SIZE; ++i)
+	{
+		loops[i].generation = ~0u;	//Not checked yet
+		loops[i].bank = 0;
+		loops[i].head = 0;
+		loops[i].branch = 0;
+		loops[i].idle = false;
+		loops[i].length = 0;
+		loops[i].readCount = 0;
+		loops[i].hits = 0;
+		loops[i].cycles = 0;
+	}
+
+	stats.hits = 0;
+	stats.cycles = 0;
+}
+
+VE_VMS_BUSYLOOPS::~VE_VMS_BUSYLOOPS()
+{
+}
+
+///Logs skip statistics at debug level (Busiest loops first)
+void VE_VMS_BUSYLOOPS::logStats()
+{
+	if(stats.hits == 0) return;
+
+	LOG_print(LOG_LEVEL_DEBUG, "Busy loops: %lu skips, %lu cycles skipped", stats.hits, stats.cycles);
+
+	bool listed[BUSYLOOP_CACHE_SIZE] = {false};
+
+	for(int n = 0; n < BUSYLOOP_REPORT; ++n)
+	{
+		int best = -1;
+
+		for(int i = 0; i < BUSYLOOP_CACHE_SIZE; ++i)
+			if(!listed[i] && loops[i].hits != 0 && (best < 0 || loops[i].cycles > loops[best].cycles)) best = i;
+
+		if(best < 0) break;
+		listed[best] = true;
+
+		const VE_VMS_BUSYLOOP &loop = loops[best];
+		LOG_print(LOG_LEVEL_DEBUG, "Busy loop %d:%04X (%d instructions): %lu skips, %lu cycles", loop.bank, loop.head, loop.length, loop.hits, loop.cycles);
+	}
+}
@@ -0,0 +1,76 @@
+/*
+    VeMUlator - A Dreamcast Visual Memory Unit emulator for libretro
+    Copyright (C) 2018  Mahmoud Jaoune
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef _BUSYLOOP_H_
+#define _BUSYLOOP_H_
+
+#include "common.h"
+#include "icache.h"
+
+//Longest loop (In instructions) that is checked for busy-waiting
+#define BUSYLOOP_MAX_LENGTH 8
+
+//Loops remembered (Power of 2)
+#define BUSYLOOP_CACHE_SIZE 256
+
+//A short loop ending in a branch back to its start, idle when its only effects are on ACC, PSW and PC and
+//it reads fixed addresses (So it does the same thing each iteration until memory it polls changes)
+struct VE_VMS_BUSYLOOP
+{
+    unsigned generation;            //Instruction cache generation this loop was checked at
+    byte bank;
+    uint16_t head;                  //Branch target
+    uint16_t branch;                //Address of branch
+    bool idle;
+    int length;                     //Instructions per iteration
+    int period;                     //Cycles per iteration
+    int readCount;
+    uint16_t reads[BUSYLOOP_MAX_LENGTH];
+    unsigned long hits;             //Times skipped
+    unsigned long cycles;           //Cycles skipped
+};
+
+//Skip statistics of a game
+struct VE_VMS_BUSYLOOP_STATS
+{
+    unsigned long hits;
+    unsigned long cycles;
+};
+
+class VE_VMS_BUSYLOOPS
+{
+public:
+    VE_VMS_BUSYLOOPS();
+    ~VE_VMS_BUSYLOOPS();
+
+    ///Returns slot of loop starting at head in bank (Its head or generation differ when it was not checked yet)
+    VE_VMS_BUSYLOOP &getLoop(byte bank, size_t head)
+    {
+        return loops[(head ^ (bank << 7)) & (BUSYLOOP_CACHE_SIZE - 1)];
+    }
+
+    ///Logs skip statistics at debug level (Busiest loops first)
+    void logStats();
+
+    VE_VMS_BUSYLOOP_STATS stats;
+
+private:
+    VE_VMS_BUSYLOOP loops[BUSYLOOP_CACHE_SIZE];
+};
+
+#endif // _BUSYLOOP_H_
@@ -0,0 +1,59 @@
+/*
+    VeMUlator - A Dreamcast Visual Memory Unit emulator for libretro
+    Copyright (C) 2018  Mahmoud Jaoune
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "clock.h"
+
+VE_VMS_CLOCK::VE_VMS_CLOCK()
+{
+	frameRemainder = 0;
+
+	setSource(CLOCK_RC, CLOCK_DIV_FAST);	//Default frequency (RC/6)
+}
+
+VE_VMS_CLOCK::~VE_VMS_CLOCK()
+{
+}
+
+///Selects oscillator and divider of CPU clock, remainders already taken stay valid since they are in ticks
+void VE_VMS_CLOCK::setSource(uint32_t _oscillator, uint32_t _divider)
+{
+	oscillator = _oscillator;
+	divider = _divider;
+	ticksPerCycle = (CLOCK_MASTER_RATE / oscillator) * divider;
+}
+
+///CPU cycles per second (Rounded down)
+uint32_t VE_VMS_CLOCK::getFrequency()
+{
+	return oscillator / divider;
+}
+
+///Whole CPU cycles in ticks plus remainder, what is left is stored back in remainder
+int VE_VMS_CLOCK::cycles(uint32_t ticks, uint32_t &remainder)
+{
+	uint32_t total = ticks + remainder;
+
+	remainder = total % ticksPerCycle;
+	return (int)(total / ticksPerCycle);
+}
+
+///CPU cycles in next frame, fraction of a cycle is carried to the following frame
+int VE_VMS_CLOCK::frameCycles()
+{
+	return cycles(CLOCK_FRAME_TICKS, frameRemainder);
+}
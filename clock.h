@@ -0,0 +1,69 @@
+/*
+    VeMUlator - A Dreamcast Visual Memory Unit emulator for libretro
+    Copyright (C) 2018  Mahmoud Jaoune
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef _CLOCK_H_
+#define _CLOCK_H_
+
+#include "common.h"
+
+//Oscillators (Hz)
+#define CLOCK_RC 600000         //What the real frequency should be (Measured ~879kHz)
+#define CLOCK_QUARTZ 32768      //32kHz sub-clock
+
+//Master clock, smallest rate every oscillator divides (LCM of RC and quartz), so a CPU cycle is a whole number of ticks
+#define CLOCK_MASTER_RATE 307200000
+#define CLOCK_FRAME_TICKS (CLOCK_MASTER_RATE / FPS)
+
+//CPU clock divider (OCR bit 7)
+#define CLOCK_DIV_FAST 6
+#define CLOCK_DIV_SLOW 12
+
+class VE_VMS_CLOCK
+{
+public:
+    VE_VMS_CLOCK();
+    ~VE_VMS_CLOCK();
+
+    //Selects oscillator (CLOCK_RC or CLOCK_QUARTZ) and divider of CPU clock
+    void setSource(uint32_t oscillator, uint32_t divider);
+
+    //Master ticks in one CPU cycle
+    uint32_t getTicksPerCycle();
+
+    //CPU cycles per second (Rounded down)
+    uint32_t getFrequency();
+
+    //Whole CPU cycles in ticks plus remainder, what is left (In ticks) is stored back in remainder
+    int cycles(uint32_t ticks, uint32_t &remainder);
+
+    //CPU cycles in next frame, fraction of a cycle is carried to the following frame
+    int frameCycles();
+
+private:
+    uint32_t oscillator;
+    uint32_t divider;
+    uint32_t ticksPerCycle;
+    uint32_t frameRemainder;    //Ticks of last frame not yet run
+};
+
+inline uint32_t VE_VMS_CLOCK::getTicksPerCycle()
+{
+    return ticksPerCycle;
+}
+
+#endif // _CLOCK_H_
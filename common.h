@@ -28,6 +28,9 @@
 #define SCREEN_WIDTH 48
 #define SCREEN_HEIGHT 32
 
+//Cycle count of an event that never happens
+#define CYCLES_NEVER 0x7FFFFFFF
+
 typedef unsigned char byte;
 
 #endif // _COMMON_H_
@@ -16,9 +16,11 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <string.h>
 #include "cpu.h"
+#include "log.h"
 
-VE_VMS_CPU::VE_VMS_CPU(VE_VMS_RAM *_ram, VE_VMS_ROM *_rom, VE_VMS_FLASH *_flash, VE_VMS_INTERRUPTS *_intHandler, bool hle)
+VE_VMS_CPU::VE_VMS_CPU(VE_VMS_RAM *_ram, VE_VMS_ROM *_rom, VE_VMS_FLASH *_flash, VE_VMS_INTERRUPTS *_intHandler, VE_VMS_ICACHE *_icache, VE_VMS_BUSYLOOPS *_busyLoops)
 {
 	PC = 0;
 
@@ -34,34 +36,35 @@ VE_VMS_CPU::VE_VMS_CPU(VE_VMS_RAM *_ram, VE_VMS_ROM *_rom, VE_VMS_FLASH *_flash,
 	rom = _rom;
 	flash = _flash;
 	intHandler = _intHandler;
-	IsHLE = hle;
-	
-	frequency = 100000.0;	//Default frequency (~879khz/6)
+	icache = _icache;
+	busyLoops = _busyLoops;
+
+	//Instruction fetch reads the bank selected by EXT
+	ram->setCodeMemory(rom->getData(), flash->getRawData());
 	
 	P3_taken = true;
-}
 
-VE_VMS_CPU::~VE_VMS_CPU()
-{
-}
+	ALU_init();
 
-double VE_VMS_CPU::getCurrentFrequency()
-{
-	return frequency;
+	blocks = new VE_VMS_BLOCKCACHE();
+
+	spinning = NULL;
+	spinLoop = NULL;
+	spinACC = 0;
+	spinPSW = 0;
+	spinStart = 0;
 }
-	
-void VE_VMS_CPU::setFrequency(double f)
+
+VE_VMS_CPU::~VE_VMS_CPU()
 {
-	frequency = f;
+	delete blocks;
 }
 
 //Memory operations
 ///Reads a byte either from ROM or Flash, depending on value of EXT
 byte VE_VMS_CPU::readByteRF(size_t address)
 {
-	if((ram->readByte_RAW(EXT) & 0x1) == 1)
-		return flash->getByte(address);
-	else return rom->readByte(address);
+	return ram->codeBank[address & 0xFFFF];
 }
 
 ///Writes a byte either from ROM or Flash, depending on value of EXT
@@ -69,185 +72,176 @@ void VE_VMS_CPU::writeByteRF(size_t address, byte d)
 {
 	if((ram->readByte_RAW(EXT) & 0x1) == 1)
 		flash->writeByte(address, d);
-	else rom->writeByte(address, d);
+	else
+	{
+		rom->writeByte(address, d);
+		ram->setCodeMemory(rom->getData(), flash->getRawData());	//ROM image is copied on first write
+	}
 }
 
 
-//Read
-byte *VE_VMS_CPU::readFromROM(size_t address, size_t byteCount)
+//Bulk transfers
+//Clamps count so [address, address + count) stays inside an area of size bytes
+static size_t clampSpan(size_t address, size_t count, size_t size)
+{
+	if(address >= size) return 0;
+	return count > size - address ? size - address : count;
+}
+
+///Copies main RAM of current bank (PSW bit 1) to out
+size_t VE_VMS_CPU::readRAM(size_t address, byte *out, size_t count)
 {
-	byte *data = new byte[byteCount];
+	count = clampSpan(address, count, 0x100);
 
-	//Write data
-	for(byte i = 0; i < byteCount; ++i)
-		data[i] = readByteRF(address);
+	//Both pages of main RAM are contiguous
+	memcpy(out, ram->pages[0] + address, count);
 
-	return data;
+	return count;
 }
-byte *VE_VMS_CPU::readFromRAM(size_t address, size_t byteCount)
+
+///Copies in to main RAM of current bank (PSW bit 1)
+size_t VE_VMS_CPU::writeRAM(size_t address, const byte *in, size_t count)
 {
-	byte *data = new byte[byteCount];
+	count = clampSpan(address, count, 0x100);
 
-	//PSW decides to which bank we read/write in RAM
-	byte PSW_data = ram->readByte_RAW(PSW);
-	if((PSW_data & 2) != 0) address += 256;
+	//Both pages of main RAM are contiguous
+	memcpy(ram->pages[0] + address, in, count);
 
-	//Read data
-	for(byte i = 0; i < byteCount; ++i)
-		data[i] = ram->readByte(address);
+	//Observed addresses (Bank 0 only) see the write as if software did it
+	if(ram->pages[0] == ram->getData()) ram->notifyObservers(address, count);
 
-	return data;
+	return count;
 }
 
-//Write
-void VE_VMS_CPU::writeToROM(byte *data, size_t dataSize, size_t address)
+size_t VE_VMS_CPU::readXRAM(int bank, size_t offset, byte *out, size_t count)
 {
-	//Write data
-	for(byte i = 0; i < dataSize; ++i)
-		writeByteRF(address, data[i]);
+	count = clampSpan(offset, count, 0x7C);
+	memcpy(out, ram->getXRAM(bank) + offset, count);
+
+	return count;
 }
 
-void VE_VMS_CPU::writeToRAM(byte *data, size_t dataSize, size_t address)
+size_t VE_VMS_CPU::writeXRAM(int bank, size_t offset, const byte *in, size_t count)
 {
-	//PSW decides to which bank we read/write in RAM
-	byte PSW_data = ram->readByte_RAW(PSW);
-	if((PSW_data & 2) != 0) address += 256;
+	count = clampSpan(offset, count, 0x7C);
+	memcpy(ram->getXRAM(bank) + offset, in, count);
+	ram->displayGeneration++;
 
-	//Write data
-	for(byte i = 0; i < dataSize; ++i)
-		ram->writeByte(address, data[i]);
+	return count;
 }
 
-//Address/Data functions
-///Immediate
-byte VE_VMS_CPU::getAddress_i8()
+size_t VE_VMS_CPU::readWRAM(size_t address, byte *out, size_t count)
 {
+	count = clampSpan(address, count, 0x200);
+	memcpy(out, ram->getWRAM() + address, count);
 
-	//if(Debug) VMU_Debug.debug("Address i8: " + Integer.toHexString(address));
-
-	return readByteRF(PC + 1) & 0xFF;
-}
-///Relative 8-bit (signed)
-signed char VE_VMS_CPU::getAddress_r8()
-{
-	//if(Debug) VMU_Debug.debug("Address r8: " + Integer.toHexString(readByteRF(PC + 1)));
-	return (signed char)readByteRF(PC + 1);
+	return count;
 }
-///Relative 8-bit when the opcode has bit specifiers (signed)
-signed char VE_VMS_CPU::getAddress_r8_b3()
+
+size_t VE_VMS_CPU::writeWRAM(size_t address, const byte *in, size_t count)
 {
-	//if(Debug) VMU_Debug.debug("Address r8 b3: " + Integer.toHexString(readByteRF(PC + 2)));
-	return (signed char)readByteRF(PC + 2);
+	count = clampSpan(address, count, 0x200);
+	memcpy(ram->getWRAM() + address, in, count);
+
+	return count;
 }
-///Relative 16-bit
-size_t VE_VMS_CPU::getAddress_r16()
+
+size_t VE_VMS_CPU::readFlash(size_t address, byte *out, size_t count)
 {
-	//if(Debug) VMU_Debug.debug("Address r16: " + Integer.toHexString((readByteRF(PC + 1) | (readByteRF(PC + 2) << 8)) & 0xFFFF));
-	return (readByteRF(PC + 1) | (readByteRF(PC + 2) << 8)) & 0xFFFF;
+	return flash->read(address, out, count);
 }
-///Direct 9-bit
-size_t VE_VMS_CPU::getAddress_d9()
-{
-	//We need opcode to get 9th bit
-	byte opcode = readByteRF(PC);
-
-	byte d9_bit = (opcode & 0x01);
-	byte operand = readByteRF(PC + 1) & 0xFF;
-
-	//if(Debug) VMU_Debug.debug("Address d9: " + Integer.toHexString(((d9_bit << 8) | operand) & 0x1FF));
-
 
-	//if(mainBank > 0) address += 256;
-
-	return ((d9_bit << 8) | operand) & 0x1FF;
-}
-///Direct 9-bit with bit assignment
-size_t VE_VMS_CPU::getAddress_d9_b3()
+size_t VE_VMS_CPU::writeFlash(size_t address, const byte *in, size_t count)
 {
-	//We need opcode to get 9th bit
-	byte opcode = readByteRF(PC);
-
-	byte d9_bit = ((opcode & 0x10) >> 4);
-	byte operand = readByteRF(PC + 1) & 0xFF;
-
-	//if(Debug) VMU_Debug.debug("Address d9 b3: " + Integer.toHexString(((d9_bit << 8) | operand) & 0x1FF));
-
-	//if(mainBank > 0) address += 256;
-
-	return ((d9_bit << 8) | operand) & 0x1FF;
+	return flash->write(address, in, count);
 }
-///Get bits (b3)
-byte VE_VMS_CPU::getAddress_b3()
+
+//Address/Data functions
+///Decodes instruction at address (Opcode and its operands), operands are laid out depending on the addressing mode of the opcode
+void VE_VMS_CPU::decodeInstruction(size_t address, VE_VMS_INSTRUCTION &inst)
 {
-	//We need opcode to get the bits
-	//if(Debug) VMU_Debug.debug("Bits= " + Integer.toHexString((readByteRF(PC) & 0x7)));
-	return (readByteRF(PC) & 0x7);
+	byte opcode = readByteRF(address);
+	const VE_VMS_OPCODE &op = opcodeTable[opcode];
+
+	inst.opcode = opcode;
+	inst.length = op.length;
+	inst.cycles = op.cycles;
+	inst.b3 = opcode & 0x7;
+	inst.Ri = opcode & 0x3;
+	inst.i8 = 0;
+	inst.r8 = 0;
+	inst.d9 = 0;
+	inst.a16 = 0;
+
+	byte operand1 = (op.length > 1) ? readByteRF(address + 1) : 0;
+	byte operand2 = (op.length > 2) ? readByteRF(address + 2) : 0;
+
+	switch(op.mode)
+	{
+		case MODE_I8:
+		case MODE_I8_R:
+			inst.i8 = operand1;
+			break;
+		case MODE_D9:
+			//9th bit is bit 0 of opcode
+			inst.d9 = ((opcode & 0x1) << 8) | operand1;
+			break;
+		case MODE_I8_D9:
+			inst.d9 = ((opcode & 0x1) << 8) | operand1;
+			inst.i8 = operand2;
+			break;
+		case MODE_D9_B3:
+			//9th bit is bit 4 of opcode
+			inst.d9 = ((opcode & 0x10) << 4) | operand1;
+			break;
+		case MODE_D9_B3_R8:
+			inst.d9 = ((opcode & 0x10) << 4) | operand1;
+			inst.r8 = (signed char)operand2;
+			break;
+		case MODE_R8:
+		case MODE_R_R8:
+			inst.r8 = (signed char)operand1;
+			break;
+		case MODE_R16:
+			//Little-endian
+			inst.a16 = operand1 | (operand2 << 8);
+			break;
+		case MODE_I8_R8:
+		case MODE_R_I8_R8:
+			inst.i8 = operand1;
+			inst.r8 = (signed char)operand2;
+			break;
+		case MODE_D9_R8:
+			inst.d9 = ((opcode & 0x1) << 8) | operand1;
+			inst.r8 = (signed char)operand2;
+			break;
+		case MODE_A12:
+			//Bits 9-12 are in opcode (Bit 12 is bit 4 of opcode)
+			inst.a16 = ((((opcode & 0x10) >> 1) | (opcode & 0x7)) << 8) | operand1;
+			break;
+		case MODE_A16:
+			//Big-endian
+			inst.a16 = (operand1 << 8) | operand2;
+			break;
+	}
 }
-///Indirect
-size_t VE_VMS_CPU::getAddress_R()
-{
-	//We need opcode to get mode
-	byte opcode = readByteRF(PC);
-
-	//The most significant bit of mode number will also be used later (As MSB of address after being read).
-	byte indirectionMSB = ((opcode & 0x2) >> 1);
-
-	//if(Debug) VMU_Debug.debug("Indirection MSB= " + Integer.toHexString(indirectionMSB));
-
-	byte mode = ((indirectionMSB << 1) | (opcode & 0x1));
-	//if(Debug) VMU_Debug.debug("Mode= " + Integer.toHexString(mode));
-
-	byte bank = (((ram->readByte_RAW(PSW) & 0x8) >> 3) | ((ram->readByte_RAW(PSW) & 0x10) >> 3));
-	//if(Debug) VMU_Debug.debug("Bank= " + Integer.toHexString(bank));
-
-	byte RAMPlace = mode & 0xFF;
 
-	if(bank == 1) RAMPlace += 4;
-	else if(bank == 2) RAMPlace += 8;
-	else if(bank > 2) RAMPlace += 12;
-
-	byte offset = 0;
-	size_t address = ram->readByte(RAMPlace + offset);
-
-	//if(Debug) VMU_Debug.debug("Address in= " + Integer.toHexString(RAMPlace + offset));
-
-	//Now put most significant bit so result is 9-bits long
-	address &= 0xFF;
-	address |= (indirectionMSB << 8);
-
-	address &= 0x1FF;
-
-	//if(Debug) VMU_Debug.debug("Address R: " + Integer.toHexString(address));
-
-	//if(Debug) VMU_Debug.debug("R Operand= " + Integer.toHexString(ram->readByte(address)));
-
-	return address;
-}
-///Absolute 12-bit
-size_t VE_VMS_CPU::getAddress_a12()
+///Disassembles instruction at address into out (Needs at least 32 bytes), returns instruction length
+int VE_VMS_CPU::disassemble(size_t address, char *out)
 {
-	//We need opcode since it has bits 9-12 of the address
-	byte opcode = readByteRF(PC);
+	VE_VMS_INSTRUCTION inst;
+	decodeInstruction(address, inst);
+	formatInstruction(inst, address, out);
 
-	byte bit_12 = ((opcode & 0x10) >> 1);
-
-	byte bits_9to12 = ((opcode & 0x7) | bit_12);
-
-	//if(Debug) VMU_Debug.debug("Address a12: " + Integer.toHexString((readByteRF(PC+1) | (bits_9to12 << 0x8)) & 0xFFF));
-
-	//Big-endian
-	return (readByteRF(PC+1) | (bits_9to12 << 0x8)) & 0xFFF;
+	return inst.length;
 }
-///Absolute 16-bit
-size_t VE_VMS_CPU::getAddress_a16()
-{
-	//Big-endian
-	byte MSB = readByteRF(PC+1);
-	byte LSB = readByteRF(PC+2);
 
-	//if(Debug) VMU_Debug.debug("Address a16: " + Integer.toHexString((((MSB << 8) | LSB) & 0xFFFF)));
-
-	return ((MSB << 8) | LSB) & 0xFFFF;
+///Indirect
+size_t VE_VMS_CPU::getAddress_R(byte Ri)
+{
+	//Indirection registers of bank selected by IRBK0 and IRBK1 (4 each) are found again by RAM when PSW is written.
+	//The most significant bit of mode number is the MSB of the 9-bit address.
+	return ram->indirectRegisters[Ri & 0x3] | ((Ri & 0x2) << 7);
 }
 
 ///Absolute 16-bit (But can select to get operand from ROM (EXT = 0) or Flash (EXT = 1), important for when an instruction changes EXT, it will always be followed by a JMPF)
@@ -293,46 +287,58 @@ byte VE_VMS_CPU::FLAG_getP()
 }
 void VE_VMS_CPU::FLAG_setOV()
 {
+	ram->syncFlags();
 	byte PSW_data = ram->readByte_RAW(PSW);
 	ram->writeByte_RAW(PSW, (PSW_data | 0x4));
 }
 void VE_VMS_CPU::FLAG_clearOV()
 {
+	ram->syncFlags();
 	byte PSW_data = ram->readByte_RAW(PSW);
 	ram->writeByte_RAW(PSW, (PSW_data & 0xFB));
 }
 byte VE_VMS_CPU::FLAG_getOV()
 {
+	if(ram->flagTable != NULL) return (ram->flagTable[ram->flagIndex] & ALU_OV) != 0;
+
 	byte PSW_data = ram->readByte_RAW(PSW);
 	return ((PSW_data & 0x4) >> 2) & 0xFF;
 }
 void VE_VMS_CPU::FLAG_setAC()
 {
+	ram->syncFlags();
 	byte PSW_data = ram->readByte_RAW(PSW);
 	ram->writeByte_RAW(PSW, (PSW_data | 0x40));
 }
 void VE_VMS_CPU::FLAG_clearAC()
 {
+	ram->syncFlags();
 	byte PSW_data = ram->readByte_RAW(PSW);
 	ram->writeByte_RAW(PSW, (PSW_data & 0xBF));
 }
 byte VE_VMS_CPU::FLAG_getAC()
 {
+	if(ram->flagTable != NULL) return (ram->flagTable[ram->flagIndex] & ALU_AC) != 0;
+
 	byte PSW_data = ram->readByte_RAW(PSW);
 	return ((PSW_data & 0x40) >> 6) & 0xFF;
 }
 void VE_VMS_CPU::FLAG_setCY()
 {
+	ram->syncFlags();
 	byte PSW_data = ram->readByte_RAW(PSW);
 	ram->writeByte_RAW(PSW, (PSW_data | 0x80));
 }
 void VE_VMS_CPU::FLAG_clearCY()
 {
+	ram->syncFlags();
 	byte PSW_data = ram->readByte_RAW(PSW);
 	ram->writeByte_RAW(PSW, (PSW_data & 0x7F));
 }
 byte VE_VMS_CPU::FLAG_getCY()
 {
+	if(ram->flagTable != NULL) return (ram->flagTable[ram->flagIndex] & ALU_CY) != 0;
+
 	byte PSW_data = ram->readByte_RAW(PSW);
 	return ((PSW_data & 0x80) >> 7) & 0xFF;
 }
@@ -344,260 +350,39 @@ byte VE_VMS_CPU::FLAG_getCY()
  ******************************************************
  ******************************************************/
 
-void VE_VMS_CPU::processInterrupts()
+bool VE_VMS_CPU::processInterrupts()
 {
-	byte IE_data = ram->readByte_RAW(IE); //Interrupt Enable control
+	uint32_t pending = intHandler->getPending();
+	if(pending == 0) return false;
 
-	//Interrupts are not blocked, and nested interrupts are less than 3 levels deep.
-	if(IE_data & 128)
-	{
-		if(intHandler->getReset() == 1)
-		{
-			//Push address to stack (16-bits, little endian).
-			//SP is increased by 2 afterwards
-			ram->stackPush(PC & 0xFF);
-			ram->stackPush((PC >> 8) & 0xFF);
-
-			//if(EXTNew == 1) ram->writeByte(EXT, 0);
-			PC = 0;
-			interruptLevel++;
-			currentInterrupt = 0;
-			interruptsMasked = true;
-			intHandler->clearReset();
-			//Enable CPU
-			ram->writeByte_RAW(PCON, 0);
-			interruptQueue.push_back(currentInterrupt);
-			return; //It is important to return after each interrupt
-		}
-		if(intHandler->getINT0() == 1 && (currentInterrupt == 0 || currentInterrupt >= 1))
-		{
-			//Push address to stack (16-bits, little endian).
-			//SP is increased by 2 afterwards
-			ram->stackPush(PC & 0xFF);
-			ram->stackPush((PC >> 8) & 0xFF);
-
-			//if(EXTNew == 1) ram->writeByte(EXT, 0);
-			PC = 0x3;
-			interruptLevel++;
-			currentInterrupt = 1;
-			interruptsMasked = true;
-			intHandler->clearINT0();
-			//Enable CPU
-			ram->writeByte_RAW(PCON, 0);
-			interruptQueue.push_back(currentInterrupt);
-			return;
-		}
-		if(intHandler->getINT1() == 1 && (currentInterrupt == 0 || currentInterrupt >= 2))
-		{
-			//Push address to stack (16-bits, little endian).
-			//SP is increased by 2 afterwards
-			ram->stackPush(PC & 0xFF);
-			ram->stackPush((PC >> 8) & 0xFF);
-
-			//if(EXTNew == 1) ram->writeByte(EXT, 0);
-			PC = 0xB;
-			interruptLevel++;
-			currentInterrupt = 2;
-			interruptsMasked = true;
-			intHandler->clearINT1();
-			//Enable CPU
-			ram->writeByte_RAW(PCON, 0);
-			interruptQueue.push_back(currentInterrupt);
-			return;
-		}
-		if(intHandler->getINT2() == 1 && (currentInterrupt == 0 || currentInterrupt >= 3))
-		{
-			//Push address to stack (16-bits, little endian).
-			//SP is increased by 2 afterwards
-			ram->stackPush(PC & 0xFF);
-			ram->stackPush((PC >> 8) & 0xFF);
-
-			//if(EXTNew == 1) ram->writeByte(EXT, 0);
-			PC = 0x13;
-			interruptLevel++;
-			currentInterrupt = 3;
-			interruptsMasked = true;
-			intHandler->clearINT2();
-			//Enable CPU
-			ram->writeByte_RAW(PCON, 0);
-			interruptQueue.push_back(currentInterrupt);
-			return;
-		}
-		if(intHandler->getINT3() == 1 && (currentInterrupt == 0 || currentInterrupt >= 4))
-		{
-			//Push address to stack (16-bits, little endian).
-			//SP is increased by 2 afterwards
-			ram->stackPush(PC & 0xFF);
-			ram->stackPush((PC >> 8) & 0xFF);
-
-			//if(EXTNew == 1) ram->writeByte(EXT, 0);
-			PC = 0x1B;
-			interruptLevel++;
-			currentInterrupt = 4;
-			interruptsMasked = true;
-			intHandler->clearINT3();
-			//Enable CPU
-			ram->writeByte_RAW(PCON, 0);
-			interruptQueue.push_back(currentInterrupt);
-			return;
-		}
-		if(intHandler->getT0HOV() == 1 && (currentInterrupt == 0 || currentInterrupt >= 5))
-		{
-			//Push address to stack (16-bits, little endian).
-			//SP is increased by 2 afterwards
-			ram->stackPush(PC & 0xFF);
-			ram->stackPush((PC >> 8) & 0xFF);
-
-			//if(EXTNew == 1) ram->writeByte(EXT, 0);
-			PC = 0x23;
-			interruptLevel++;
-			currentInterrupt = 5;
-			interruptsMasked = true;
-			intHandler->clearT0HOV();
-			//Enable CPU
-			ram->writeByte_RAW(PCON, 0);
-			interruptQueue.push_back(currentInterrupt);
-			return;
-		}
-		if(intHandler->getT1HLOV() == 1 && (currentInterrupt == 0 || currentInterrupt >= 6))
-		{
-			//Push address to stack (16-bits, little endian).
-			//SP is increased by 2 afterwards
-			ram->stackPush(PC & 0xFF);
-			ram->stackPush((PC >> 8) & 0xFF);
-
-			//if(EXTNew == 1) ram->writeByte(EXT, 0);
-			PC = 0x2B;
-			interruptLevel++;
-			currentInterrupt = 6;
-			interruptsMasked = true;
-			intHandler->clearT1HLOV();
-			//Enable CPU
-			ram->writeByte_RAW(PCON, 0);
-			interruptQueue.push_back(currentInterrupt);
-			return;
-		}
-		if(intHandler->getSIO0() == 1 && (currentInterrupt == 0 || currentInterrupt >= 7))
-		{
-			//Push address to stack (16-bits, little endian).
-			//SP is increased by 2 afterwards
-			ram->stackPush(PC & 0xFF);
-			ram->stackPush((PC >> 8) & 0xFF);
-
-			//if(EXTNew == 1) ram->writeByte(EXT, 0);
-			PC = 0x33;
-			interruptLevel++;
-			currentInterrupt = 7;
-			interruptsMasked = true;
-			intHandler->clearSIO0();
-			//Enable CPU
-			ram->writeByte_RAW(PCON, 0);
-			interruptQueue.push_back(currentInterrupt);
-			return;
-		}
-		if(intHandler->getSIO1() == 1 && (currentInterrupt == 0 || currentInterrupt >= 8))
-		{
-			//Push address to stack (16-bits, little endian).
-			//SP is increased by 2 afterwards
-			ram->stackPush(PC & 0xFF);
-			ram->stackPush((PC >> 8) & 0xFF);
-
-			//if(EXTNew == 1) ram->writeByte(EXT, 0);
-			PC = 0x3B;
-			interruptLevel++;
-			currentInterrupt = 8;
-			interruptsMasked = true;
-			intHandler->clearSIO1();
-			//Enable CPU
-			ram->writeByte_RAW(PCON, 0);
-			interruptQueue.push_back(currentInterrupt);
-			return;
-		}
-		if(intHandler->getRFB() == 1 && (currentInterrupt == 0 || currentInterrupt >= 9))
-		{
-			//Push address to stack (16-bits, little endian).
-			//SP is increased by 2 afterwards
-			ram->stackPush(PC & 0xFF);
-			ram->stackPush((PC >> 8) & 0xFF);
-
-			//if(EXTNew == 1) ram->writeByte(EXT, 0);
-			PC = 0x43;
-			interruptLevel++;
-			currentInterrupt = 9;
-			interruptsMasked = true;
-			intHandler->clearRFB();
-			//Enable CPU
-			ram->writeByte_RAW(PCON, 0);
-			interruptQueue.push_back(currentInterrupt);
-			return;
-		}
-		if(intHandler->getP3() == 1 && (currentInterrupt == 0 || currentInterrupt >= 10))
-		{
-			//Push address to stack (16-bits, little endian).
-			//SP is increased by 2 afterwards
-			ram->stackPush(PC & 0xFF);
-			ram->stackPush((PC >> 8) & 0xFF);
-
-			//if(EXTNew == 1) ram->writeByte(EXT, 0);
-			PC = 0x4B;
-			interruptLevel++;
-			currentInterrupt = 10;
-			interruptsMasked = true;
-			intHandler->clearP3();
-			//Enable CPU
-			ram->writeByte_RAW(PCON, 0);
-			interruptQueue.push_back(currentInterrupt);
-			return;
-		}
-	}
-	//Interrupts are blocked except for non-maskables (INT0 and INT1
-	else 
-	{
-		//If INT0 and INT1 are not blocked
-		if((IE_data & 1) == 0)
-		{
-			if(intHandler->getINT0() == 1 && (currentInterrupt == 0 || currentInterrupt >= 1))
-			{
-				//Push address to stack (16-bits, little endian).
-				//SP is increased by 2 afterwards
-				ram->stackPush(PC & 0xFF);
-				ram->stackPush((PC >> 8) & 0xFF);
-
-
-				//if(EXTNew == 1) ram->writeByte(EXT, 0);
-				PC = 0x3;
-				interruptLevel++;
-				currentInterrupt = 1;
-				interruptsMasked = true;
-				intHandler->clearINT0();
-				//Enable CPU
-				ram->writeByte_RAW(PCON, 0);
-				interruptQueue.push_back(currentInterrupt);
-				return;
-			}
-			//If INT1 is not blocked, process it
-			if((IE_data & 2) == 0)
-			{
-				if(intHandler->getINT1() == 1 && (currentInterrupt == 0 || currentInterrupt >= 2)){
-					//Push address to stack (16-bits, little endian).
-					//SP is increased by 2 afterwards
-					ram->stackPush(PC & 0xFF);
-					ram->stackPush((PC >> 8) & 0xFF);
-
-					//if(EXTNew == 1) ram->writeByte(EXT, 0);
-					PC = 0xB;
-					interruptLevel++;
-					currentInterrupt = 2;
-					interruptsMasked = true;
-					intHandler->clearINT1();
-					//Enable CPU
-					ram->writeByte_RAW(PCON, 0);
-					interruptQueue.push_back(currentInterrupt);
-					return;
-				}
-			}
-		}
-	}
+	pending &= VE_VMS_INTERRUPTS::getEnabled(ram->readByte_RAW(IE));
+	if(pending == 0) return false;
+
+	//Highest priority source, it can only interrupt a handler of the same or lower priority
+	int source = lowestBit(pending);
+	if(currentInterrupt != 0 && source > currentInterrupt) return false;
+
+	//Handler must see real PSW
+	ram->syncFlags();
+
+	//Push address to stack (16-bits, little endian).
+	//SP is increased by 2 afterwards
+	ram->stackPush(PC & 0xFF);
+	ram->stackPush((PC >> 8) & 0xFF);
+
+	PC = VE_VMS_INTERRUPTS::getVector(source);
+	currentInterrupt = source;
+	interruptsMasked = true;
+	intHandler->clear(source);
+
+	//Remember source for RETI (Deeper levels are only counted)
+	if(interruptLevel < INTERRUPT_STACK_DEPTH) interruptStack[interruptLevel] = source;
+	interruptLevel++;
+
+	//Enable CPU
+	ram->writeByte_RAW(PCON, 0);
+
+	return true;
 }
 
 
@@ -605,7 +390,7 @@ void VE_VMS_CPU::processInterrupts()
 void VE_VMS_CPU::performHLE(size_t entryAddress)
 {
 	//We must never go back to BIOS when there is no BIOS...
-	ram->writeByte_RAW(EXT, 1);    //Never ever...
+	ram->writeByte(EXT, 1);    //Never ever...
 
 	//Emulate system calls
 
@@ -625,10 +410,9 @@ void VE_VMS_CPU::performHLE(size_t entryAddress)
 		byte flashBank = ram->readByte(0x7D);
 		if(flashBank == 1) startAddress += 0x10000;
 
-		for(size_t i = 0; i < 128; ++i, startAddress++)
-		{
-			flash->writeByte_RAW(startAddress, ram->readByte(0x80 + i));
-		}
+		byte buffer[128];
+		readRAM(0x80, buffer, 128);
+		writeFlash(startAddress, buffer, 128);
 
 		ram->writeByte(ACC, 0);
 
@@ -646,15 +430,11 @@ void VE_VMS_CPU::performHLE(size_t entryAddress)
 		byte flashBank = ram->readByte(0x7D);
 		if(flashBank == 1) startAddress += 0x10000;
 
-		for(size_t i = 0; i < 128; ++i, startAddress++)
-		{
-			if(flash->getByte(startAddress) != ram->readByte(0x80 + i))
-			{
-				ram->writeByte(ACC, 0xFF);
-				break;
-			}
-			else ram->writeByte(ACC, 0);
-		}
+		byte buffer[128], flashBuffer[128];
+		readRAM(0x80, buffer, 128);
+		size_t count = readFlash(startAddress, flashBuffer, 128);
+
+		ram->writeByte(ACC, memcmp(buffer, flashBuffer, count) != 0 ? 0xFF : 0);
 
 		PC = 0x115;
 	}
@@ -671,10 +451,9 @@ void VE_VMS_CPU::performHLE(size_t entryAddress)
 		byte flashBank = ram->readByte(0x7D);
 		if(flashBank == 1) startAddress += 0x10000;
 
-		for(size_t i = 0; i < 128; ++i, startAddress++)
-		{
-			ram->writeByte(0x80 + i, flash->getByte(startAddress));
-		}
+		byte buffer[128];
+		size_t count = readFlash(startAddress, buffer, 128);
+		writeRAM(0x80, buffer, count);
 
 		PC = 0x125;
 	}
@@ -747,10 +526,10 @@ void VE_VMS_CPU::performHLE(size_t entryAddress)
 
 }
 
-int VE_VMS_CPU::processInstruction(bool dbg) 
+//Follows EXT changes (An instruction that changes EXT is always followed by a JMPF in the other bank)
+template<class System>
+void VE_VMS_CPU::checkEXT()
 {
-	if(state != 1) return 0;  //CPU in halt state
-
 	EXTNew = ram->readByte_RAW(EXT) & 0x1;
 
 	if(EXTOld != EXTNew) 
@@ -758,7 +537,7 @@ int VE_VMS_CPU::processInstruction(bool dbg)
 		if(EXTNew == 0)
 		{
 				//We are in ROM now, so read JMPF from Flash and jump to it here.
-				if(!IsHLE) PC = getAddress_a16(1);
+				if(!System::hle) PC = getAddress_a16(1);
 				else 
 				{
 					performHLE(getAddress_a16(1));
@@ -767,1385 +546,1509 @@ int VE_VMS_CPU::processInstruction(bool dbg)
 		} 
 		else 
 		{
-				if(!IsHLE) PC = getAddress_a16(0);
+				if(!System::hle) PC = getAddress_a16(0);
 		}
 	}
 
-	if(!IsHLE) EXTOld = ram->readByte_RAW(EXT) & 0x1;
+	if(!System::hle) EXTOld = ram->readByte_RAW(EXT) & 0x1;
+}
 
-	byte opcode = readByteRF(PC);
-	
-	//printf("Instruction: %#04x\n", opcode);
+void VE_VMS_CPU::traceInstruction(const VE_VMS_INSTRUCTION &inst, size_t address)
+{
+	char text[32];
+	formatInstruction(inst, address, text);
+	LOG_print(LOG_LEVEL_DEBUG, "%04X: %s", (unsigned)address, text);
+}
 
-	byte cycles = 0;
+//BR, BZ, BNZ, BP, BN, BE i8/d9 and BNE i8/d9, the only branches an idle loop may end in
+static bool isLoopBranch(byte op)
+{
+	return op == 0x01 || op == 0x80 || op == 0x90 || (op & 0xE8) == 0x68 || (op & 0xE8) == 0x88 ||
+		(op >= 0x31 && op <= 0x33) || (op >= 0x41 && op <= 0x43);
+}
 
-	//NOP
-	if(opcode == 0x00)
-	{
-		//Does nothing
+template<class System, class Trace>
+int VE_VMS_CPU::processInstruction() 
+{
+	if(state != 1) return 0;  //CPU in halt state
 
+	checkEXT<System>();
 
-		//Instruction pointer
-		PC += 1;
+	//Fetch predecoded instruction from the bank EXT selects, decode it on first use
+	byte bank = ram->readByte_RAW(EXT) & 0x1;
+	size_t address = PC;
+	VE_VMS_ICACHE_ENTRY &entry = icache->getEntry(bank, address);
 
-		//Set its cycles
-		cycles = 1;
-	}
-	//ADD i8
-	else if(opcode == 0x81)
+	if(entry.handler == NULL)
 	{
-		byte ACC_data = ram->readByte_RAW(ACC);
-
-		byte operand = getAddress_i8();
+		decodeInstruction(PC, entry.inst);
+		entry.handler = handlers[entry.inst.opcode];
+	}
 
-		byte *result = new byte[2];
-		add8(ACC_data, operand, 0, result);
+	if(Trace::enabled) traceInstruction(entry.inst, PC);
 
-		//Flags (It is more efficient to compare to 0 rather than do shift and compare to 1)
-		if((result[1] & 0x1) == 0) FLAG_clearCY(); else FLAG_setCY();
-		if((result[1] & 0x2) == 0) FLAG_clearAC(); else FLAG_setAC();
-		if((result[1] & 0x4) == 0) FLAG_clearOV(); else FLAG_setOV();
+	//Keep cycles and opcode, since the handler may invalidate this entry (e.g. STC)
+	int cycles = entry.inst.cycles;
+	byte opcode = entry.inst.opcode;
 
-		ram->writeByte_RAW(ACC, result[0]);
+	//Instruction pointer (Branches are relative to the next instruction)
+	PC = (PC + entry.inst.length) & 0xFFFF;
 
-		//Instruction pointer
-		PC += 2;
+	//Execute
+	(this->*entry.handler)(entry.inst);
 
-		//Set its cycles
-		cycles = 1;
-		
-		delete []result;
-	}
-	//ADD d9
-	else if(opcode == 0x82 || opcode == 0x83)
-	{
-		byte ACC_data = ram->readByte_RAW(ACC);
+	++instructionCount;
 
-		size_t address = getAddress_d9();
-		byte operand = ram->readByte(address);
+	//Branched back, may be spinning
+	if(PC <= address && isLoopBranch(opcode)) checkBusyLoop(bank, address);
+	
+	return cycles;
+}
 
-		byte *result = new byte[2];
-		add8(ACC_data, operand, 0, result);
 
-		//Flags (It is more efficient to compare to 0 rather than do shift and compare to 1)
-		if((result[1] & 0x1) == 0) FLAG_clearCY(); else FLAG_setCY();
-		if((result[1] & 0x2) == 0) FLAG_clearAC(); else FLAG_setAC();
-		if((result[1] & 0x4) == 0) FLAG_clearOV(); else FLAG_setOV();
+/******************************************************
+ ******************************************************
+ *  Superblocks
+ ******************************************************
+ ******************************************************/
 
-		ram->writeByte_RAW(ACC, result[0]);
+//Instructions that change PC (Or code) end a block
+static bool isBlockEnd(const VE_VMS_INSTRUCTION &inst)
+{
+	switch(opcodeTable[inst.opcode].mode)
+	{
+		case MODE_D9_B3_R8:
+		case MODE_R8:
+		case MODE_R16:
+		case MODE_I8_R8:
+		case MODE_D9_R8:
+		case MODE_R_R8:
+		case MODE_R_I8_R8:
+		case MODE_A12:
+		case MODE_A16:
+			return true;
+	}
+
+	//RET, RETI and STC Flash (May modify code of this block)
+	return inst.opcode == 0xA0 || inst.opcode == 0xB0 || inst.opcode == 0x51;
+}
 
-		//Instruction pointer
-		PC += 2;
+//Returns superinstruction for a pair of instructions, NULL if they can't be fused
+VE_VMS_FUSED_HANDLER VE_VMS_CPU::findFusion(const VE_VMS_INSTRUCTION &first, const VE_VMS_INSTRUCTION &second)
+{
+	byte op1 = first.opcode;
+	byte op2 = second.opcode;
 
-		//Set its cycles
-		cycles = 1;
-		
-		delete []result;
+	//LD d9
+	if((op1 & 0xFE) == 0x02)
+	{
+		if((op2 & 0xFE) == 0x12) return &VE_VMS_CPU::fop_LD_ST;	//ST d9
+		if(op2 == 0x80) return &VE_VMS_CPU::fop_LD_BZ;
+		if(op2 == 0x90) return &VE_VMS_CPU::fop_LD_BNZ;
+		if(op2 == 0x31) return &VE_VMS_CPU::fop_LD_BE;			//BE i8
+		if(op2 == 0x41) return &VE_VMS_CPU::fop_LD_BNE;			//BNE i8
 	}
-	//ADD @R
-	else if(opcode >= 0x84 && opcode <= 0x87)
+	//AND i8
+	else if(op1 == 0xE1)
 	{
-		byte ACC_data = ram->readByte_RAW(ACC);
-
-		size_t address = getAddress_R();
-		byte operand = ram->readByte(address);
-		
+		if(op2 == 0x80) return &VE_VMS_CPU::fop_AND_BZ;
+		if(op2 == 0x90) return &VE_VMS_CPU::fop_AND_BNZ;
+	}
 
-		byte *result = new byte[2];
-		add8(ACC_data, operand, 0, result);
+	return NULL;
+}
 
-		//Flags (It is more efficient to compare to 0 rather than do shift and compare to 1)
-		if((result[1] & 0x1) == 0) FLAG_clearCY(); else FLAG_setCY();
-		if((result[1] & 0x2) == 0) FLAG_clearAC(); else FLAG_setAC();
-		if((result[1] & 0x4) == 0) FLAG_clearOV(); else FLAG_setOV();
+//Gathers straight-line code at address into a new block
+VE_VMS_BLOCK *VE_VMS_CPU::buildBlock(byte bank, size_t address)
+{
+	VE_VMS_BLOCK *block = new VE_VMS_BLOCK;
 
-		ram->writeByte_RAW(ACC, result[0]);
+	block->generation = icache->getGeneration(bank);
+	block->opCount = 0;
+	block->instructionCount = 0;
+	block->cycles = 0;
+	block->cyclesAt[0] = 0;
 
-		//Instruction pointer
-		PC += 1;
+	VE_VMS_ICACHE_ENTRY *previous = NULL;
 
-		//Set its cycles
-		cycles = 1;
-		
-		delete []result;
-	}
-	//ADC i8
-	else if(opcode == 0x91)
+	while(block->instructionCount < BLOCK_MAX_LENGTH)
 	{
-		byte ACC_data = ram->readByte_RAW(ACC);
-
-		byte operand = getAddress_i8();
-		byte c = 0;
-		if(FLAG_getCY() == 1)
-			c = 1;
+		VE_VMS_ICACHE_ENTRY &entry = icache->getEntry(bank, address);
 
+		if(entry.handler == NULL)
+		{
+			decodeInstruction(address, entry.inst);
+			entry.handler = handlers[entry.inst.opcode];
+		}
 
-		byte *result = new byte[2];
-		add8(ACC_data, operand, c, result);
+		VE_VMS_FUSED_HANDLER fused = NULL;
+		if(previous != NULL) fused = findFusion(previous->inst, entry.inst);
 
-		//Flags (It is more efficient to compare to 0 rather than do shift and compare to 1)
-		if((result[1] & 0x1) == 0) FLAG_clearCY(); else FLAG_setCY();
-		if((result[1] & 0x2) == 0) FLAG_clearAC(); else FLAG_setAC();
-		if((result[1] & 0x4) == 0) FLAG_clearOV(); else FLAG_setOV();
+		if(fused != NULL)
+		{
+			//Merge into previous op
+			VE_VMS_BLOCK_OP &op = block->ops[block->opCount - 1];
+			op.fused = fused;
+			op.second = &entry.inst;
+			op.length += entry.inst.length;
+			op.count = 2;
+			op.cycles += entry.inst.cycles;
+
+			previous = NULL;	//Never fuse more than two
+		}
+		else
+		{
+			VE_VMS_BLOCK_OP &op = block->ops[block->opCount++];
+			op.handler = entry.handler;
+			op.fused = NULL;
+			op.first = &entry.inst;
+			op.second = NULL;
+			op.length = entry.inst.length;
+			op.count = 1;
+			op.cycles = entry.inst.cycles;
+
+			previous = &entry;
+		}
 
-		ram->writeByte_RAW(ACC, result[0]);
+		block->instructionCount++;
+		block->cycles += entry.inst.cycles;
+		block->cyclesAt[block->instructionCount] = block->cycles;
+		block->last = address;
+		block->loopBranch = isLoopBranch(entry.inst.opcode);
 
-		//Instruction pointer
-		PC += 2;
+		if(isBlockEnd(entry.inst)) break;
 
-		//Set its cycles
-		cycles = 1;
-		
-		delete []result;
+		address = (address + entry.inst.length) & 0xFFFF;
 	}
-	//ADC d9
-	else if(opcode == 0x92 || opcode == 0x93)
-	{
-		byte ACC_data = ram->readByte_RAW(ACC);
 
-		size_t address = getAddress_d9();
-		byte operand = ram->readByte(address);
-		byte c = 0;
-		if(FLAG_getCY() == 1)
-			c = 1;
+	blocks->stats.built++;
 
+	return block;
+}
 
-		byte *result = new byte[2];
-		add8(ACC_data, operand, c, result);
-
-		//Flags (It is more efficient to compare to 0 rather than do shift and compare to 1)
-		if((result[1] & 0x1) == 0) FLAG_clearCY(); else FLAG_setCY();
-		if((result[1] & 0x2) == 0) FLAG_clearAC(); else FLAG_setAC();
-		if((result[1] & 0x4) == 0) FLAG_clearOV(); else FLAG_setOV();
+///Runs one superblock (Its instructions that start within maxCycles), returns cycles they took
+template<class System, class Trace>
+int VE_VMS_CPU::runBlock(int maxCycles)
+{
+	if(state != 1) return 0;  //CPU in halt state
 
-		ram->writeByte_RAW(ACC, result[0]);
+	checkEXT<System>();
 
-		//Instruction pointer
-		PC += 2;
+	byte bank = ram->readByte_RAW(EXT) & 0x1;
 
-		//Set its cycles
-		cycles = 1;
-		
-		delete []result;
-	}
-	//ADC @R
-	else if(opcode >= 0x94 && opcode <= 0x97)
-	{
-		byte ACC_data = ram->readByte_RAW(ACC);
+	return executeBlock<Trace>(getBlock(bank), bank, maxCycles);
+}
 
-		size_t address = getAddress_R();
-		byte operand = ram->readByte(address);
-		byte c = 0;
-		if(FLAG_getCY() == 1)
-			c = 1;
+int VE_VMS_CPU::getInstructionCount()
+{
+	return instructionCount;
+}
 
+//Returns block at PC, (Re)built if missing or code was modified since it was built
+VE_VMS_BLOCK *VE_VMS_CPU::getBlock(byte bank)
+{
+	VE_VMS_BLOCK *&block = blocks->getBlock(bank, PC);
 
-		byte *result = new byte[2];
-		add8(ACC_data, operand, c, result);
-		//Flags (It is more efficient to compare to 0 rather than do shift and compare to 1)
-		if((result[1] & 0x1) == 0) FLAG_clearCY(); else FLAG_setCY();
-		if((result[1] & 0x2) == 0) FLAG_clearAC(); else FLAG_setAC();
-		if((result[1] & 0x4) == 0) FLAG_clearOV(); else FLAG_setOV();
+	if(block == NULL || block->generation != icache->getGeneration(bank))
+	{
+		delete block;
+		block = buildBlock(bank, PC);
+	}
 
-		ram->writeByte_RAW(ACC, result[0]);
+	return block;
+}
 
-		//Instruction pointer
-		PC += 1;
+//Interprets block (Instructions that start within maxCycles, last one may end after it), returns cycles taken
+template<class Trace>
+int VE_VMS_CPU::executeBlock(VE_VMS_BLOCK *block, byte bank, int maxCycles)
+{
+	int executed = 0;
+	int cycles = 0;
+	int fusedExecuted = 0;
+	bool pending = intHandler->hasPending();	//Interrupts already waiting here are masked
 
-		//Set its cycles
-		cycles = 1;
-		
-		delete []result;
-	}
-	//SUB i8
-	else if(opcode == 0xA1)
+	for(int i = 0; i < block->opCount; ++i)
 	{
-		byte ACC_data = ram->readByte_RAW(ACC);
+		const VE_VMS_BLOCK_OP &op = block->ops[i];
+
+		if(Trace::enabled) traceInstruction(*op.first, PC);
 
-		byte operand = getAddress_i8();
+		if(op.fused != NULL && cycles + op.first->cycles < maxCycles)
+		{
+			if(Trace::enabled) traceInstruction(*op.second, (PC + op.first->length) & 0xFFFF);
 
-		byte *result = new byte[2];
-		sub8(ACC_data, operand, 0, result);
+			PC = (PC + op.length) & 0xFFFF;
+			(this->*op.fused)(*op.first, *op.second);
 
-		//Flags (It is more efficient to compare to 0 rather than do shift and compare to 1)
-		if((result[1] & 0x1) == 0) FLAG_clearCY(); else FLAG_setCY();
-		if((result[1] & 0x2) == 0) FLAG_clearAC(); else FLAG_setAC();
-		if((result[1] & 0x4) == 0) FLAG_clearOV(); else FLAG_setOV();
+			fusedExecuted += 2;
+		}
+		else
+		{
+			//Not fused (Or second one would start after budget)
+			PC = (PC + op.first->length) & 0xFFFF;
+			(this->*op.handler)(*op.first);
 
-		ram->writeByte_RAW(ACC, result[0]);
+			if(op.count == 2)
+			{
+				executed++;
+				cycles += op.first->cycles;
+				break;
+			}
+		}
 
-		//Instruction pointer
-		PC += 2;
+		executed += op.count;
+		cycles += op.cycles;
 
-		//Set its cycles
-		cycles = 1;
-		
-		delete []result;
+		//Leave early if CPU was halted, code bank changed or an interrupt is waiting
+		if(cycles >= maxCycles) break;
+		if(ram->readByte_RAW(PCON) != 0 || (ram->readByte_RAW(EXT) & 0x1) != bank) break;
+		if(!pending && intHandler->hasPending()) break;
 	}
-	//SUB d9
-	else if(opcode == 0xA2 || opcode == 0xA3)
-	{
-		byte ACC_data = ram->readByte_RAW(ACC);
 
-		size_t address = getAddress_d9();
-		byte operand = ram->readByte(address);
+	instructionCount += executed;
 
-		byte *result = new byte[2];
-		sub8(ACC_data, operand, 0, result);
+	//Whole block ran and branched back, may be spinning
+	if(executed == block->instructionCount && block->loopBranch && PC <= block->last) checkBusyLoop(bank, block->last);
 
-		//Flags (It is more efficient to compare to 0 rather than do shift and compare to 1)
-		if((result[1] & 0x1) == 0) FLAG_clearCY(); else FLAG_setCY();
-		if((result[1] & 0x2) == 0) FLAG_clearAC(); else FLAG_setAC();
-		if((result[1] & 0x4) == 0) FLAG_clearOV(); else FLAG_setOV();
+	blocks->stats.blocks++;
+	blocks->stats.instructions += executed;
+	blocks->stats.fused += fusedExecuted;
+	blocks->stats.cycles += cycles;
 
-		ram->writeByte_RAW(ACC, result[0]);
+	return cycles;
+}
 
-		//Instruction pointer
-		PC += 2;
+//Instantiations for each policy the run loop can pick (JIT needs checkEXT and the block interpreter too)
+template void VE_VMS_CPU::checkEXT<VE_VMS_HLE>();
+template void VE_VMS_CPU::checkEXT<VE_VMS_BIOS>();
+template int VE_VMS_CPU::processInstruction<VE_VMS_HLE, VE_VMS_TRACE_OFF>();
+template int VE_VMS_CPU::processInstruction<VE_VMS_HLE, VE_VMS_TRACE_ON>();
+template int VE_VMS_CPU::processInstruction<VE_VMS_BIOS, VE_VMS_TRACE_OFF>();
+template int VE_VMS_CPU::processInstruction<VE_VMS_BIOS, VE_VMS_TRACE_ON>();
+template int VE_VMS_CPU::runBlock<VE_VMS_HLE, VE_VMS_TRACE_OFF>(int maxCycles);
+template int VE_VMS_CPU::runBlock<VE_VMS_HLE, VE_VMS_TRACE_ON>(int maxCycles);
+template int VE_VMS_CPU::runBlock<VE_VMS_BIOS, VE_VMS_TRACE_OFF>(int maxCycles);
+template int VE_VMS_CPU::runBlock<VE_VMS_BIOS, VE_VMS_TRACE_ON>(int maxCycles);
+template int VE_VMS_CPU::executeBlock<VE_VMS_TRACE_OFF>(VE_VMS_BLOCK *block, byte bank, int maxCycles);
+
+///Logs superblock statistics at debug level (Nothing when no block ran)
+void VE_VMS_CPU::logBlockStats()
+{
+	VE_VMS_BLOCK_STATS &stats = blocks->stats;
 
-		//Set its cycles
-		cycles = 1;
-		
-		delete []result;
-	}
-	//SUB @R
-	else if(opcode >= 0xA4 && opcode <= 0xA7)
-	{
-		byte ACC_data = ram->readByte_RAW(ACC);
+	if(stats.blocks == 0 || stats.instructions == 0) return;
 
-		size_t address = getAddress_R();
-		byte operand = ram->readByte(address);
+	LOG_print(LOG_LEVEL_DEBUG, "Superblocks: %lu built, %lu run, %lu instructions, %lu cycles", stats.built, stats.blocks, stats.instructions, stats.cycles);
+	LOG_print(LOG_LEVEL_DEBUG, "Average block length: %.2f instructions", (double)stats.instructions / stats.blocks);
+	LOG_print(LOG_LEVEL_DEBUG, "Fusion hit rate: %.2f%% of instructions", 100.0 * stats.fused / stats.instructions);
+}
 
-		byte *result = new byte[2];
-		sub8(ACC_data, operand, 0, result);
 
-		//Flags (It is more efficient to compare to 0 rather than do shift and compare to 1)
-		if((result[1] & 0x1) == 0) FLAG_clearCY(); else FLAG_setCY();
-		if((result[1] & 0x2) == 0) FLAG_clearAC(); else FLAG_setAC();
-		if((result[1] & 0x4) == 0) FLAG_clearOV(); else FLAG_setOV();
+/******************************************************
+ ******************************************************
+ *  Busy-wait loops
+ ******************************************************
+ ******************************************************/
 
-		ram->writeByte_RAW(ACC, result[0]);
+///Called after a conditional branch (Or BR) at branch went back to PC. An idle loop that ran a whole iteration without changing
+///ACC or PSW will do the same in every iteration until memory it polls changes, caller may skip those.
+void VE_VMS_CPU::checkBusyLoop(byte bank, size_t branch)
+{
+	VE_VMS_BUSYLOOP &loop = busyLoops->getLoop(bank, PC);
 
-		//Instruction pointer
-		PC += 1;
+	if(loop.head != PC || loop.bank != bank || loop.generation != icache->getGeneration(bank)) analyzeLoop(loop, bank, PC);
 
-		//Set its cycles
-		cycles = 1;
-		
-		delete []result;
-	}
-	//SUBC i8
-	else if(opcode == 0xB1)
+	if(!loop.idle || loop.branch != branch)
 	{
-		byte ACC_data = ram->readByte_RAW(ACC);
-
-		byte operand = getAddress_i8();
-		byte c = 0;
-		if(FLAG_getCY() == 1)
-			c = 1;
-
-		byte *result = new byte[2];
-		sub8(ACC_data, operand, c, result);
-		//Flags (It is more efficient to compare to 0 rather than do shift and compare to 1)
-		if((result[1] & 0x1) == 0) FLAG_clearCY(); else FLAG_setCY();
-		if((result[1] & 0x2) == 0) FLAG_clearAC(); else FLAG_setAC();
-		if((result[1] & 0x4) == 0) FLAG_clearOV(); else FLAG_setOV();
-
-		ram->writeByte_RAW(ACC, result[0]);
-
-		//Instruction pointer
-		PC += 2;
-
-		//Set its cycles
-		cycles = 1;
-		
-		delete []result;
+		spinLoop = NULL;
+		return;
 	}
-	//SUBC d9
-	else if(opcode == 0xB2 || opcode == 0xB3)
-	{
-		byte ACC_data = ram->readByte_RAW(ACC);
 
-		size_t address = getAddress_d9();
-		byte operand = ram->readByte(address);
-		byte c = 0;
-		if(FLAG_getCY() == 1)
-			c = 1;
+	ram->syncFlags();
+	byte ACC_data = ram->readByte_RAW(ACC);
+	byte PSW_data = ram->readByte_RAW(PSW);
 
+	//Anything else in between (An interrupt) runs more instructions
+	if(spinLoop == &loop && spinACC == ACC_data && spinPSW == PSW_data && instructionCount - spinStart == loop.length) spinning = &loop;
 
-		byte *result = new byte[2];
-		sub8(ACC_data, operand, c, result);
-		//Flags (It is more efficient to compare to 0 rather than do shift and compare to 1)
-		if((result[1] & 0x1) == 0) FLAG_clearCY(); else FLAG_setCY();
-		if((result[1] & 0x2) == 0) FLAG_clearAC(); else FLAG_setAC();
-		if((result[1] & 0x4) == 0) FLAG_clearOV(); else FLAG_setOV();
+	spinLoop = &loop;
+	spinACC = ACC_data;
+	spinPSW = PSW_data;
+	spinStart = instructionCount;
+}
 
-		ram->writeByte_RAW(ACC, result[0]);
+//Idle loops are NOP, LD, AND and OR (Only change ACC), ending in a conditional branch (Or BR) back to head.
+//All memory they read is at fixed addresses.
+void VE_VMS_CPU::analyzeLoop(VE_VMS_BUSYLOOP &loop, byte bank, size_t head)
+{
+	loop.generation = icache->getGeneration(bank);
+	loop.bank = bank;
+	loop.head = head;
+	loop.branch = 0;
+	loop.idle = false;
+	loop.length = 0;
+	loop.period = 0;
+	loop.readCount = 0;
+	loop.hits = 0;
+	loop.cycles = 0;
 
-		//Instruction pointer
-		PC += 2;
+	size_t address = head;
+	int timerReads = 0;
 
-		//Set its cycles
-		cycles = 1;
-		
-		delete []result;
-	}
-	//SUBC @R
-	else if(opcode >= 0xB4 && opcode <= 0xB7)
+	while(loop.length < BUSYLOOP_MAX_LENGTH)
 	{
-		byte ACC_data = ram->readByte_RAW(ACC);
+		VE_VMS_ICACHE_ENTRY &entry = icache->getEntry(bank, address);
 
-		size_t address = getAddress_R();
-		byte operand = ram->readByte(address);
-		byte c = 0;
-		if(FLAG_getCY() == 1)
-			c = 1;
+		if(entry.handler == NULL)
+		{
+			decodeInstruction(address, entry.inst);
+			entry.handler = handlers[entry.inst.opcode];
+		}
 
+		const VE_VMS_INSTRUCTION &inst = entry.inst;
+		byte op = inst.opcode;
+		byte mode = opcodeTable[op].mode;
 
-		byte *result = new byte[2];
-		sub8(ACC_data, operand, c, result);
-		//Flags (It is more efficient to compare to 0 rather than do shift and compare to 1)
-		if((result[1] & 0x1) == 0) FLAG_clearCY(); else FLAG_setCY();
-		if((result[1] & 0x2) == 0) FLAG_clearAC(); else FLAG_setAC();
-		if((result[1] & 0x4) == 0) FLAG_clearOV(); else FLAG_setOV();
+		loop.length++;
+		loop.period += inst.cycles;
 
-		ram->writeByte_RAW(ACC, result[0]);
+		if(mode == MODE_D9 || mode == MODE_D9_B3_R8 || mode == MODE_D9_R8)
+		{
+			//Reading work RAM buffer moves VRMAD
+			if(inst.d9 == VTRBF) return;
 
-		//Instruction pointer
-		PC += 1;
+			//Timers are synced by each read, a second one would hide what the first saw
+			if(VE_VMS_RAM::isTimerSFR(inst.d9) && ++timerReads > 1) return;
 
-		//Set its cycles
-		cycles = 1;
-		
-		delete []result;
-	}
-	//INC d9
-	else if(opcode == 0x62 || opcode == 0x63)
-	{
-		size_t address = getAddress_d9();
+			loop.reads[loop.readCount++] = inst.d9;
+		}
 
-		byte data = ram->readByte(address);
-		data += 1;
-		ram->writeByte(address, data);
+		//NOP, LD d9, OR i8/d9 and AND i8/d9
+		if(op == 0x00 || (op & 0xFE) == 0x02 || op == 0xD1 || (op & 0xFE) == 0xD2 || op == 0xE1 || (op & 0xFE) == 0xE2)
+		{
+			address = (address + inst.length) & 0xFFFF;
+			continue;
+		}
 
-		//Instruction pointer
-		PC += 2;
+		if(isLoopBranch(op) && ((address + inst.length + inst.r8) & 0xFFFF) == head)
+		{
+			loop.branch = address;
+			loop.idle = true;
+		}
 
-		//Set its cycles
-		cycles = 1;
+		return;
 	}
-	//INC @R
-	else if(opcode >= 0x64 && opcode <= 0x67)
-	{
-		//if(dbg) VMU_Debug.debug("INC @R:");
-		size_t address = getAddress_R();
+}
 
-		byte data = ram->readByte(address);
-		data += 1;
-		ram->writeByte(address, data);
 
-		//Instruction pointer
-		PC += 1;
+/******************************************************
+ ******************************************************
+ *  Fused instructions (Superinstructions)
+ ******************************************************
+ ******************************************************/
 
-		//Set its cycles
-		cycles = 1;
-	}
-	//DEC d9
-	else if(opcode == 0x72 || opcode == 0x73)
-	{
-		size_t address = getAddress_d9();
+//LD d9, ST d9
+void VE_VMS_CPU::fop_LD_ST(const VE_VMS_INSTRUCTION &first, const VE_VMS_INSTRUCTION &second)
+{
+	byte data = ram->readByte(first.d9);
 
-		byte data = ram->readByte(address);
-		data -= 1;
-		ram->writeByte(address, data);
+	ram->writeByte_RAW(ACC, data);
+	ram->writeByte(second.d9, data);
+}
 
-		//Instruction pointer
-		PC += 2;
+//LD d9, BZ r8
+void VE_VMS_CPU::fop_LD_BZ(const VE_VMS_INSTRUCTION &first, const VE_VMS_INSTRUCTION &second)
+{
+	byte data = ram->readByte(first.d9);
 
-		//Set its cycles
-		cycles = 1;
-	}
-	//DEC @R
-	else if(opcode >= 0x74 && opcode <= 0x77)
-	{
-		size_t address = getAddress_R();
+	ram->writeByte_RAW(ACC, data);
 
-		byte data = ram->readByte(address);
-		data -= 1;
-		ram->writeByte(address, data);
+	if(data == 0) PC = (PC + second.r8) & 0xFFFF;
+}
 
-		//Instruction pointer
-		PC += 1;
+//LD d9, BNZ r8
+void VE_VMS_CPU::fop_LD_BNZ(const VE_VMS_INSTRUCTION &first, const VE_VMS_INSTRUCTION &second)
+{
+	byte data = ram->readByte(first.d9);
 
-		//Set its cycles
-		cycles = 1;
-	}
-	//MUL
-	else if(opcode == 0x30)
-	{
-		uint32_t operand = ram->readByte_RAW(C) | (ram->readByte(ACC) << 8);
-		byte operand2 = ram->readByte_RAW(B);
-		operand *= operand2;    //This is 24-bits
-
-		//B: High 8-bits
-		//ACC_data: Mid 8-bits
-		//C: Low 8-bits
-		ram->writeByte_RAW(B, ((operand & 0xFF0000) >> 16));
-		ram->writeByte_RAW(ACC, ((operand & 0xFF00) >> 8));
-		ram->writeByte_RAW(C, (operand & 0xFF));
-
-		//Flags
-		FLAG_clearCY();
-		if(((operand & 0xFF0000) >> 16) != 0) FLAG_setOV(); else FLAG_clearOV();
-
-		//Instruction pointer
-		PC += 1;
-
-		//Set its cycles
-		cycles = 7;
-	}
-	//DIV
-	else if(opcode == 0x40)
-	{
-		uint16_t operand = ram->readByte_RAW(C) | (ram->readByte(ACC) << 8);
-		byte operand2 = ram->readByte_RAW(B);
+	ram->writeByte_RAW(ACC, data);
 
-		uint16_t quotient = operand;
-		uint16_t remainder = operand;
+	if(data != 0) PC = (PC + second.r8) & 0xFFFF;
+}
 
-		if(operand2 != 0) 
-		{
-			quotient /= operand2;
-			remainder %= operand2;
+//LD d9, BE i8, r8
+void VE_VMS_CPU::fop_LD_BE(const VE_VMS_INSTRUCTION &first, const VE_VMS_INSTRUCTION &second)
+{
+	byte data = ram->readByte(first.d9);
 
-			//Store quotient
-			ram->writeByte_RAW(ACC, ((quotient & 0xFF00) >> 8));
-			ram->writeByte_RAW(C, (quotient & 0xFF));
+	ram->writeByte_RAW(ACC, data);
 
-			//Store remainder
-			ram->writeByte_RAW(B, (remainder & 0xFF));
+	if(data == second.i8) PC = (PC + second.r8) & 0xFFFF;
 
-			FLAG_clearOV();
-		}
-		else 
-		{
-			ram->writeByte_RAW(ACC, 0xFF);
-			FLAG_setOV();
-		}
+	if(data < second.i8) FLAG_setCY(); else FLAG_clearCY();
+}
 
-		//Flags
-		FLAG_clearCY();
+//LD d9, BNE i8, r8
+void VE_VMS_CPU::fop_LD_BNE(const VE_VMS_INSTRUCTION &first, const VE_VMS_INSTRUCTION &second)
+{
+	byte data = ram->readByte(first.d9);
 
-		//Instruction pointer
-		PC += 1;
+	ram->writeByte_RAW(ACC, data);
 
-		//Set its cycles
-		cycles = 7;
-	}
-	//AND i8
-	else if(opcode == 0xE1)
-	{
-		byte operand = getAddress_i8();
-		byte ACC_data = ram->readByte_RAW(ACC);
+	if(data != second.i8) PC = (PC + second.r8) & 0xFFFF;
 
-		ACC_data &= operand;
+	if(data < second.i8) FLAG_setCY(); else FLAG_clearCY();
+}
 
-		ram->writeByte_RAW(ACC, ACC_data);
+//AND i8, BZ r8
+void VE_VMS_CPU::fop_AND_BZ(const VE_VMS_INSTRUCTION &first, const VE_VMS_INSTRUCTION &second)
+{
+	byte data = ram->readByte_RAW(ACC) & first.i8;
 
-		//Instruction pointer
-		PC += 2;
+	ram->writeByte_RAW(ACC, data);
 
-		//Set its cycles
-		cycles = 1;
-	}
-	//AND d9
-	else if(opcode == 0xE2 || opcode == 0xE3)
-	{
-		byte operand = ram->readByte(getAddress_d9());
-		byte ACC_data = ram->readByte_RAW(ACC);
-
-		ACC_data &= operand;
-
-		ram->writeByte_RAW(ACC, ACC_data);
+	if(data == 0) PC = (PC + second.r8) & 0xFFFF;
+}
 
-		//Instruction pointer
-		PC += 2;
+//AND i8, BNZ r8
+void VE_VMS_CPU::fop_AND_BNZ(const VE_VMS_INSTRUCTION &first, const VE_VMS_INSTRUCTION &second)
+{
+	byte data = ram->readByte_RAW(ACC) & first.i8;
 
-		//Set its cycles
-		cycles = 1;
-	}
-	//AND @R
-	else if(opcode >= 0xE4 && opcode <= 0xE7)
-	{
-		byte operand = ram->readByte(getAddress_R());
-		byte ACC_data = ram->readByte_RAW(ACC);
+	ram->writeByte_RAW(ACC, data);
 
-		ACC_data &= operand;
+	if(data != 0) PC = (PC + second.r8) & 0xFFFF;
+}
 
-		ram->writeByte_RAW(ACC, ACC_data);
+/******************************************************
+ ******************************************************
+ *  Instruction handlers
+ ******************************************************
+ ******************************************************/
 
-		//Instruction pointer
-		PC += 1;
+//Dispatch table, indexed by opcode
+const VE_VMS_HANDLER VE_VMS_CPU::handlers[256] =
+{
+	&VE_VMS_CPU::op_NOP,               //0x00
+	&VE_VMS_CPU::op_BR,                //0x01
+	&VE_VMS_CPU::op_LD_d9,             //0x02
+	&VE_VMS_CPU::op_LD_d9,             //0x03
+	&VE_VMS_CPU::op_LD_R,              //0x04
+	&VE_VMS_CPU::op_LD_R,              //0x05
+	&VE_VMS_CPU::op_LD_R,              //0x06
+	&VE_VMS_CPU::op_LD_R,              //0x07
+	&VE_VMS_CPU::op_CALL,              //0x08
+	&VE_VMS_CPU::op_CALL,              //0x09
+	&VE_VMS_CPU::op_CALL,              //0x0A
+	&VE_VMS_CPU::op_CALL,              //0x0B
+	&VE_VMS_CPU::op_CALL,              //0x0C
+	&VE_VMS_CPU::op_CALL,              //0x0D
+	&VE_VMS_CPU::op_CALL,              //0x0E
+	&VE_VMS_CPU::op_CALL,              //0x0F
+	&VE_VMS_CPU::op_CALLR,             //0x10
+	&VE_VMS_CPU::op_BRF,               //0x11
+	&VE_VMS_CPU::op_ST_d9,             //0x12
+	&VE_VMS_CPU::op_ST_d9,             //0x13
+	&VE_VMS_CPU::op_ST_R,              //0x14
+	&VE_VMS_CPU::op_ST_R,              //0x15
+	&VE_VMS_CPU::op_ST_R,              //0x16
+	&VE_VMS_CPU::op_ST_R,              //0x17
+	&VE_VMS_CPU::op_CALL,              //0x18
+	&VE_VMS_CPU::op_CALL,              //0x19
+	&VE_VMS_CPU::op_CALL,              //0x1A
+	&VE_VMS_CPU::op_CALL,              //0x1B
+	&VE_VMS_CPU::op_CALL,              //0x1C
+	&VE_VMS_CPU::op_CALL,              //0x1D
+	&VE_VMS_CPU::op_CALL,              //0x1E
+	&VE_VMS_CPU::op_CALL,              //0x1F
+	&VE_VMS_CPU::op_CALLF,             //0x20
+	&VE_VMS_CPU::op_JMPF,              //0x21
+	&VE_VMS_CPU::op_MOV_d9,            //0x22
+	&VE_VMS_CPU::op_MOV_d9,            //0x23
+	&VE_VMS_CPU::op_MOV_R,             //0x24
+	&VE_VMS_CPU::op_MOV_R,             //0x25
+	&VE_VMS_CPU::op_MOV_R,             //0x26
+	&VE_VMS_CPU::op_MOV_R,             //0x27
+	&VE_VMS_CPU::op_JMP,               //0x28
+	&VE_VMS_CPU::op_JMP,               //0x29
+	&VE_VMS_CPU::op_JMP,               //0x2A
+	&VE_VMS_CPU::op_JMP,               //0x2B
+	&VE_VMS_CPU::op_JMP,               //0x2C
+	&VE_VMS_CPU::op_JMP,               //0x2D
+	&VE_VMS_CPU::op_JMP,               //0x2E
+	&VE_VMS_CPU::op_JMP,               //0x2F
+	&VE_VMS_CPU::op_MUL,               //0x30
+	&VE_VMS_CPU::op_BE_i8,             //0x31
+	&VE_VMS_CPU::op_BE_d9,             //0x32
+	&VE_VMS_CPU::op_BE_d9,             //0x33
+	&VE_VMS_CPU::op_BE_R,              //0x34
+	&VE_VMS_CPU::op_BE_R,              //0x35
+	&VE_VMS_CPU::op_BE_R,              //0x36
+	&VE_VMS_CPU::op_BE_R,              //0x37
+	&VE_VMS_CPU::op_JMP,               //0x38
+	&VE_VMS_CPU::op_JMP,               //0x39
+	&VE_VMS_CPU::op_JMP,               //0x3A
+	&VE_VMS_CPU::op_JMP,               //0x3B
+	&VE_VMS_CPU::op_JMP,               //0x3C
+	&VE_VMS_CPU::op_JMP,               //0x3D
+	&VE_VMS_CPU::op_JMP,               //0x3E
+	&VE_VMS_CPU::op_JMP,               //0x3F
+	&VE_VMS_CPU::op_DIV,               //0x40
+	&VE_VMS_CPU::op_BNE_i8,            //0x41
+	&VE_VMS_CPU::op_BNE_d9,            //0x42
+	&VE_VMS_CPU::op_BNE_d9,            //0x43
+	&VE_VMS_CPU::op_BNE_R,             //0x44
+	&VE_VMS_CPU::op_BNE_R,             //0x45
+	&VE_VMS_CPU::op_BNE_R,             //0x46
+	&VE_VMS_CPU::op_BNE_R,             //0x47
+	&VE_VMS_CPU::op_BPC,               //0x48
+	&VE_VMS_CPU::op_BPC,               //0x49
+	&VE_VMS_CPU::op_BPC,               //0x4A
+	&VE_VMS_CPU::op_BPC,               //0x4B
+	&VE_VMS_CPU::op_BPC,               //0x4C
+	&VE_VMS_CPU::op_BPC,               //0x4D
+	&VE_VMS_CPU::op_BPC,               //0x4E
+	&VE_VMS_CPU::op_BPC,               //0x4F
+	&VE_VMS_CPU::op_LDF,               //0x50
+	&VE_VMS_CPU::op_STF,               //0x51
+	&VE_VMS_CPU::op_DBNZ_d9,           //0x52
+	&VE_VMS_CPU::op_DBNZ_d9,           //0x53
+	&VE_VMS_CPU::op_DBNZ_R,            //0x54
+	&VE_VMS_CPU::op_DBNZ_R,            //0x55
+	&VE_VMS_CPU::op_DBNZ_R,            //0x56
+	&VE_VMS_CPU::op_DBNZ_R,            //0x57
+	&VE_VMS_CPU::op_BPC,               //0x58
+	&VE_VMS_CPU::op_BPC,               //0x59
+	&VE_VMS_CPU::op_BPC,               //0x5A
+	&VE_VMS_CPU::op_BPC,               //0x5B
+	&VE_VMS_CPU::op_BPC,               //0x5C
+	&VE_VMS_CPU::op_BPC,               //0x5D
+	&VE_VMS_CPU::op_BPC,               //0x5E
+	&VE_VMS_CPU::op_BPC,               //0x5F
+	&VE_VMS_CPU::op_PUSH,              //0x60
+	&VE_VMS_CPU::op_PUSH,              //0x61
+	&VE_VMS_CPU::op_INC_d9,            //0x62
+	&VE_VMS_CPU::op_INC_d9,            //0x63
+	&VE_VMS_CPU::op_INC_R,             //0x64
+	&VE_VMS_CPU::op_INC_R,             //0x65
+	&VE_VMS_CPU::op_INC_R,             //0x66
+	&VE_VMS_CPU::op_INC_R,             //0x67
+	&VE_VMS_CPU::op_BP,                //0x68
+	&VE_VMS_CPU::op_BP,                //0x69
+	&VE_VMS_CPU::op_BP,                //0x6A
+	&VE_VMS_CPU::op_BP,                //0x6B
+	&VE_VMS_CPU::op_BP,                //0x6C
+	&VE_VMS_CPU::op_BP,                //0x6D
+	&VE_VMS_CPU::op_BP,                //0x6E
+	&VE_VMS_CPU::op_BP,                //0x6F
+	&VE_VMS_CPU::op_POP,               //0x70
+	&VE_VMS_CPU::op_POP,               //0x71
+	&VE_VMS_CPU::op_DEC_d9,            //0x72
+	&VE_VMS_CPU::op_DEC_d9,            //0x73
+	&VE_VMS_CPU::op_DEC_R,             //0x74
+	&VE_VMS_CPU::op_DEC_R,             //0x75
+	&VE_VMS_CPU::op_DEC_R,             //0x76
+	&VE_VMS_CPU::op_DEC_R,             //0x77
+	&VE_VMS_CPU::op_BP,                //0x78
+	&VE_VMS_CPU::op_BP,                //0x79
+	&VE_VMS_CPU::op_BP,                //0x7A
+	&VE_VMS_CPU::op_BP,                //0x7B
+	&VE_VMS_CPU::op_BP,                //0x7C
+	&VE_VMS_CPU::op_BP,                //0x7D
+	&VE_VMS_CPU::op_BP,                //0x7E
+	&VE_VMS_CPU::op_BP,                //0x7F
+	&VE_VMS_CPU::op_BZ,                //0x80
+	&VE_VMS_CPU::op_ADD_i8,            //0x81
+	&VE_VMS_CPU::op_ADD_d9,            //0x82
+	&VE_VMS_CPU::op_ADD_d9,            //0x83
+	&VE_VMS_CPU::op_ADD_R,             //0x84
+	&VE_VMS_CPU::op_ADD_R,             //0x85
+	&VE_VMS_CPU::op_ADD_R,             //0x86
+	&VE_VMS_CPU::op_ADD_R,             //0x87
+	&VE_VMS_CPU::op_BN,                //0x88
+	&VE_VMS_CPU::op_BN,                //0x89
+	&VE_VMS_CPU::op_BN,                //0x8A
+	&VE_VMS_CPU::op_BN,                //0x8B
+	&VE_VMS_CPU::op_BN,                //0x8C
+	&VE_VMS_CPU::op_BN,                //0x8D
+	&VE_VMS_CPU::op_BN,                //0x8E
+	&VE_VMS_CPU::op_BN,                //0x8F
+	&VE_VMS_CPU::op_BNZ,               //0x90
+	&VE_VMS_CPU::op_ADDC_i8,           //0x91
+	&VE_VMS_CPU::op_ADDC_d9,           //0x92
+	&VE_VMS_CPU::op_ADDC_d9,           //0x93
+	&VE_VMS_CPU::op_ADDC_R,            //0x94
+	&VE_VMS_CPU::op_ADDC_R,            //0x95
+	&VE_VMS_CPU::op_ADDC_R,            //0x96
+	&VE_VMS_CPU::op_ADDC_R,            //0x97
+	&VE_VMS_CPU::op_BN,                //0x98
+	&VE_VMS_CPU::op_BN,                //0x99
+	&VE_VMS_CPU::op_BN,                //0x9A
+	&VE_VMS_CPU::op_BN,                //0x9B
+	&VE_VMS_CPU::op_BN,                //0x9C
+	&VE_VMS_CPU::op_BN,                //0x9D
+	&VE_VMS_CPU::op_BN,                //0x9E
+	&VE_VMS_CPU::op_BN,                //0x9F
+	&VE_VMS_CPU::op_RET,               //0xA0
+	&VE_VMS_CPU::op_SUB_i8,            //0xA1
+	&VE_VMS_CPU::op_SUB_d9,            //0xA2
+	&VE_VMS_CPU::op_SUB_d9,            //0xA3
+	&VE_VMS_CPU::op_SUB_R,             //0xA4
+	&VE_VMS_CPU::op_SUB_R,             //0xA5
+	&VE_VMS_CPU::op_SUB_R,             //0xA6
+	&VE_VMS_CPU::op_SUB_R,             //0xA7
+	&VE_VMS_CPU::op_NOT1,              //0xA8
+	&VE_VMS_CPU::op_NOT1,              //0xA9
+	&VE_VMS_CPU::op_NOT1,              //0xAA
+	&VE_VMS_CPU::op_NOT1,              //0xAB
+	&VE_VMS_CPU::op_NOT1,              //0xAC
+	&VE_VMS_CPU::op_NOT1,              //0xAD
+	&VE_VMS_CPU::op_NOT1,              //0xAE
+	&VE_VMS_CPU::op_NOT1,              //0xAF
+	&VE_VMS_CPU::op_RETI,              //0xB0
+	&VE_VMS_CPU::op_SUBC_i8,           //0xB1
+	&VE_VMS_CPU::op_SUBC_d9,           //0xB2
+	&VE_VMS_CPU::op_SUBC_d9,           //0xB3
+	&VE_VMS_CPU::op_SUBC_R,            //0xB4
+	&VE_VMS_CPU::op_SUBC_R,            //0xB5
+	&VE_VMS_CPU::op_SUBC_R,            //0xB6
+	&VE_VMS_CPU::op_SUBC_R,            //0xB7
+	&VE_VMS_CPU::op_NOT1,              //0xB8
+	&VE_VMS_CPU::op_NOT1,              //0xB9
+	&VE_VMS_CPU::op_NOT1,              //0xBA
+	&VE_VMS_CPU::op_NOT1,              //0xBB
+	&VE_VMS_CPU::op_NOT1,              //0xBC
+	&VE_VMS_CPU::op_NOT1,              //0xBD
+	&VE_VMS_CPU::op_NOT1,              //0xBE
+	&VE_VMS_CPU::op_NOT1,              //0xBF
+	&VE_VMS_CPU::op_ROR,               //0xC0
+	&VE_VMS_CPU::op_LDC,               //0xC1
+	&VE_VMS_CPU::op_XCH_d9,            //0xC2
+	&VE_VMS_CPU::op_XCH_d9,            //0xC3
+	&VE_VMS_CPU::op_XCH_R,             //0xC4
+	&VE_VMS_CPU::op_XCH_R,             //0xC5
+	&VE_VMS_CPU::op_XCH_R,             //0xC6
+	&VE_VMS_CPU::op_XCH_R,             //0xC7
+	&VE_VMS_CPU::op_CLR1,              //0xC8
+	&VE_VMS_CPU::op_CLR1,              //0xC9
+	&VE_VMS_CPU::op_CLR1,              //0xCA
+	&VE_VMS_CPU::op_CLR1,              //0xCB
+	&VE_VMS_CPU::op_CLR1,              //0xCC
+	&VE_VMS_CPU::op_CLR1,              //0xCD
+	&VE_VMS_CPU::op_CLR1,              //0xCE
+	&VE_VMS_CPU::op_CLR1,              //0xCF
+	&VE_VMS_CPU::op_RORC,              //0xD0
+	&VE_VMS_CPU::op_OR_i8,             //0xD1
+	&VE_VMS_CPU::op_OR_d9,             //0xD2
+	&VE_VMS_CPU::op_OR_d9,             //0xD3
+	&VE_VMS_CPU::op_OR_R,              //0xD4
+	&VE_VMS_CPU::op_OR_R,              //0xD5
+	&VE_VMS_CPU::op_OR_R,              //0xD6
+	&VE_VMS_CPU::op_OR_R,              //0xD7
+	&VE_VMS_CPU::op_CLR1,              //0xD8
+	&VE_VMS_CPU::op_CLR1,              //0xD9
+	&VE_VMS_CPU::op_CLR1,              //0xDA
+	&VE_VMS_CPU::op_CLR1,              //0xDB
+	&VE_VMS_CPU::op_CLR1,              //0xDC
+	&VE_VMS_CPU::op_CLR1,              //0xDD
+	&VE_VMS_CPU::op_CLR1,              //0xDE
+	&VE_VMS_CPU::op_CLR1,              //0xDF
+	&VE_VMS_CPU::op_ROL,               //0xE0
+	&VE_VMS_CPU::op_AND_i8,            //0xE1
+	&VE_VMS_CPU::op_AND_d9,            //0xE2
+	&VE_VMS_CPU::op_AND_d9,            //0xE3
+	&VE_VMS_CPU::op_AND_R,             //0xE4
+	&VE_VMS_CPU::op_AND_R,             //0xE5
+	&VE_VMS_CPU::op_AND_R,             //0xE6
+	&VE_VMS_CPU::op_AND_R,             //0xE7
+	&VE_VMS_CPU::op_SET1,              //0xE8
+	&VE_VMS_CPU::op_SET1,              //0xE9
+	&VE_VMS_CPU::op_SET1,              //0xEA
+	&VE_VMS_CPU::op_SET1,              //0xEB
+	&VE_VMS_CPU::op_SET1,              //0xEC
+	&VE_VMS_CPU::op_SET1,              //0xED
+	&VE_VMS_CPU::op_SET1,              //0xEE
+	&VE_VMS_CPU::op_SET1,              //0xEF
+	&VE_VMS_CPU::op_ROLC,              //0xF0
+	&VE_VMS_CPU::op_XOR_i8,            //0xF1
+	&VE_VMS_CPU::op_XOR_d9,            //0xF2
+	&VE_VMS_CPU::op_XOR_d9,            //0xF3
+	&VE_VMS_CPU::op_XOR_R,             //0xF4
+	&VE_VMS_CPU::op_XOR_R,             //0xF5
+	&VE_VMS_CPU::op_XOR_R,             //0xF6
+	&VE_VMS_CPU::op_XOR_R,             //0xF7
+	&VE_VMS_CPU::op_SET1,              //0xF8
+	&VE_VMS_CPU::op_SET1,              //0xF9
+	&VE_VMS_CPU::op_SET1,              //0xFA
+	&VE_VMS_CPU::op_SET1,              //0xFB
+	&VE_VMS_CPU::op_SET1,              //0xFC
+	&VE_VMS_CPU::op_SET1,              //0xFD
+	&VE_VMS_CPU::op_SET1,              //0xFE
+	&VE_VMS_CPU::op_SET1               //0xFF
+};
+
+//Flags are only computed when PSW is read (See VE_VMS_RAM::syncFlags)
+void VE_VMS_CPU::doADD(byte operand, byte carry)
+{
+	byte ACC_data = ram->readByte_RAW(ACC);
 
-		//Set its cycles
-		cycles = 1;
-	}
-	//OR i8
-	else if(opcode == 0xD1)
-	{
-		byte operand = getAddress_i8();
-		byte ACC_data = ram->readByte_RAW(ACC);
+	ram->flagTable = ALU_addFlags;
+	ram->flagIndex = (carry << 16) | (ACC_data << 8) | operand;
+	ram->writeByte_RAW(ACC, (ACC_data + operand + carry) & 0xFF);
+}
 
-		ACC_data |= operand;
+void VE_VMS_CPU::doSUB(byte operand, byte carry)
+{
+	byte ACC_data = ram->readByte_RAW(ACC);
 
-		ram->writeByte_RAW(ACC, ACC_data);
+	ram->flagTable = ALU_subFlags;
+	ram->flagIndex = (carry << 16) | (ACC_data << 8) | operand;
+	ram->writeByte_RAW(ACC, (ACC_data - operand - carry) & 0xFF);
+}
 
-		//Instruction pointer
-		PC += 2;
+//NOP
+void VE_VMS_CPU::op_NOP(const VE_VMS_INSTRUCTION &inst)
+{
+	//Does nothing
+}
 
-		//Set its cycles
-		cycles = 1;
-	}
-	//OR d9
-	else if(opcode == 0xD2 || opcode == 0xD3)
-	{
-		byte operand = ram->readByte(getAddress_d9());
-		byte ACC_data = ram->readByte_RAW(ACC);
+//ADD i8
+void VE_VMS_CPU::op_ADD_i8(const VE_VMS_INSTRUCTION &inst)
+{
+	doADD(inst.i8, 0);
+}
 
-		ACC_data |= operand;
+//ADD d9
+void VE_VMS_CPU::op_ADD_d9(const VE_VMS_INSTRUCTION &inst)
+{
+	doADD(ram->readByte(inst.d9), 0);
+}
 
-		ram->writeByte_RAW(ACC, ACC_data);
+//ADD @R
+void VE_VMS_CPU::op_ADD_R(const VE_VMS_INSTRUCTION &inst)
+{
+	doADD(ram->readByte(getAddress_R(inst.Ri)), 0);
+}
 
-		//Instruction pointer
-		PC += 2;
+//ADDC i8
+void VE_VMS_CPU::op_ADDC_i8(const VE_VMS_INSTRUCTION &inst)
+{
+	doADD(inst.i8, FLAG_getCY());
+}
 
-		//Set its cycles
-		cycles = 1;
-	}
-	//OR @R
-	else if(opcode >= 0xD4 && opcode <= 0xD7)
-	{
-		byte operand = ram->readByte(getAddress_R());
-		byte ACC_data = ram->readByte_RAW(ACC);
+//ADDC d9
+void VE_VMS_CPU::op_ADDC_d9(const VE_VMS_INSTRUCTION &inst)
+{
+	byte operand = ram->readByte(inst.d9);
 
-		ACC_data |= operand;
+	doADD(operand, FLAG_getCY());
+}
 
-		ram->writeByte_RAW(ACC, ACC_data);
+//ADDC @R
+void VE_VMS_CPU::op_ADDC_R(const VE_VMS_INSTRUCTION &inst)
+{
+	byte operand = ram->readByte(getAddress_R(inst.Ri));
 
-		//Instruction pointer
-		PC += 1;
+	doADD(operand, FLAG_getCY());
+}
 
-		//Set its cycles
-		cycles = 1;
-	}
-	//XOR i8
-	else if(opcode == 0xF1)
-	{
-		byte operand = getAddress_i8();
-		byte ACC_data = ram->readByte_RAW(ACC);
+//SUB i8
+void VE_VMS_CPU::op_SUB_i8(const VE_VMS_INSTRUCTION &inst)
+{
+	doSUB(inst.i8, 0);
+}
 
-		ACC_data ^= operand;
+//SUB d9
+void VE_VMS_CPU::op_SUB_d9(const VE_VMS_INSTRUCTION &inst)
+{
+	doSUB(ram->readByte(inst.d9), 0);
+}
 
-		ram->writeByte_RAW(ACC, ACC_data);
+//SUB @R
+void VE_VMS_CPU::op_SUB_R(const VE_VMS_INSTRUCTION &inst)
+{
+	doSUB(ram->readByte(getAddress_R(inst.Ri)), 0);
+}
 
-		//Instruction pointer
-		PC += 2;
+//SUBC i8
+void VE_VMS_CPU::op_SUBC_i8(const VE_VMS_INSTRUCTION &inst)
+{
+	doSUB(inst.i8, FLAG_getCY());
+}
 
-		//Set its cycles
-		cycles = 1;
-	}
-	//XOR d9
-	else if(opcode == 0xF2 || opcode == 0xF3)
-	{
-		byte operand = ram->readByte(getAddress_d9());
-		byte ACC_data = ram->readByte_RAW(ACC);
+//SUBC d9
+void VE_VMS_CPU::op_SUBC_d9(const VE_VMS_INSTRUCTION &inst)
+{
+	byte operand = ram->readByte(inst.d9);
 
-		ACC_data ^= operand;
+	doSUB(operand, FLAG_getCY());
+}
 
-		ram->writeByte_RAW(ACC, ACC_data);
+//SUBC @R
+void VE_VMS_CPU::op_SUBC_R(const VE_VMS_INSTRUCTION &inst)
+{
+	byte operand = ram->readByte(getAddress_R(inst.Ri));
 
-		//Instruction pointer
-		PC += 2;
+	doSUB(operand, FLAG_getCY());
+}
 
-		//Set its cycles
-		cycles = 1;
-	}
-	//XOR @R
-	else if(opcode >= 0xF4 && opcode <= 0xF7)
-	{
-		byte operand = ram->readByte(getAddress_R());
-		byte ACC_data = ram->readByte_RAW(ACC);
+//INC d9
+void VE_VMS_CPU::op_INC_d9(const VE_VMS_INSTRUCTION &inst)
+{
+	byte data = ram->readByte(inst.d9);
+	data += 1;
+	ram->writeByte(inst.d9, data);
+}
 
-		ACC_data ^= operand;
+//INC @R
+void VE_VMS_CPU::op_INC_R(const VE_VMS_INSTRUCTION &inst)
+{
+	size_t address = getAddress_R(inst.Ri);
 
-		ram->writeByte_RAW(ACC, ACC_data);
+	byte data = ram->readByte(address);
+	data += 1;
+	ram->writeByte(address, data);
+}
 
-		//Instruction pointer
-		PC += 1;
+//DEC d9
+void VE_VMS_CPU::op_DEC_d9(const VE_VMS_INSTRUCTION &inst)
+{
+	byte data = ram->readByte(inst.d9);
+	data -= 1;
+	ram->writeByte(inst.d9, data);
+}
 
-		//Set its cycles
-		cycles = 1;
-	}
-	//ROL
-	else if(opcode == 0xE0)
-	{
-		byte ACC_data = ram->readByte_RAW(ACC);
+//DEC @R
+void VE_VMS_CPU::op_DEC_R(const VE_VMS_INSTRUCTION &inst)
+{
+	size_t address = getAddress_R(inst.Ri);
 
-		byte MSB = ((ACC_data & 0x80) >> 7);
+	byte data = ram->readByte(address);
+	data -= 1;
+	ram->writeByte(address, data);
+}
 
-		ACC_data <<= 1;
-		ACC_data &= 0xFE;
-		ACC_data |= MSB;
+//MUL
+void VE_VMS_CPU::op_MUL(const VE_VMS_INSTRUCTION &inst)
+{
+	uint32_t operand = ram->readByte_RAW(C) | (ram->readByte(ACC) << 8);
+	byte operand2 = ram->readByte_RAW(B);
+	operand *= operand2;    //This is 24-bits
+
+	//B: High 8-bits
+	//ACC_data: Mid 8-bits
+	//C: Low 8-bits
+	ram->writeByte_RAW(B, ((operand & 0xFF0000) >> 16));
+	ram->writeByte_RAW(ACC, ((operand & 0xFF00) >> 8));
+	ram->writeByte_RAW(C, (operand & 0xFF));
+
+	//Flags
+	FLAG_clearCY();
+	if(((operand & 0xFF0000) >> 16) != 0) FLAG_setOV(); else FLAG_clearOV();
+}
 
-		ram->writeByte_RAW(ACC, ACC_data);
+//DIV
+void VE_VMS_CPU::op_DIV(const VE_VMS_INSTRUCTION &inst)
+{
+	uint16_t operand = ram->readByte_RAW(C) | (ram->readByte(ACC) << 8);
+	byte operand2 = ram->readByte_RAW(B);
 
-		//Instruction pointer
-		PC += 1;
+	uint16_t quotient = operand;
+	uint16_t remainder = operand;
 
-		//Set its cycles
-		cycles = 1;
-	}
-	//ROLC
-	else if(opcode == 0xF0)
+	if(operand2 != 0) 
 	{
-		byte ACC_data = ram->readByte_RAW(ACC);
-
-		byte MSB1 = (ACC_data & 0x80);   //No need to shift since it will be copied to 8th bit of PSW (CY flag)
-		byte MSB2 = ((ram->readByte_RAW(PSW) & 0x80) >> 7);
-
-		byte PSW_data = ram->readByte_RAW(PSW);
-		PSW_data &= 0x7F;
-		PSW_data |= MSB1;
-		ram->writeByte(PSW, PSW_data);
+		quotient /= operand2;
+		remainder %= operand2;
 
-		ACC_data <<= 1;
-		ACC_data &= 0xFE;    //Just to make sure
-		ACC_data |= MSB2;
+		//Store quotient
+		ram->writeByte_RAW(ACC, ((quotient & 0xFF00) >> 8));
+		ram->writeByte_RAW(C, (quotient & 0xFF));
 
-		ram->writeByte_RAW(ACC, ACC_data);
+		//Store remainder
+		ram->writeByte_RAW(B, (remainder & 0xFF));
 
-		//Instruction pointer
-		PC += 1;
-
-		//Set its cycles
-		cycles = 1;
+		FLAG_clearOV();
 	}
-	//ROR
-	else if(opcode == 0xC0)
+	else 
 	{
-		byte ACC_data = ram->readByte_RAW(ACC);
-
-		byte LSB = ((ACC_data & 0x1) << 7) & 0x80;
-
-		ACC_data >>= 1;
-		ACC_data &= 0x7F;    //To set MSB to 0
-		ACC_data |= LSB;
-
-		ram->writeByte_RAW(ACC, ACC_data);
-
-		//Instruction pointer
-		PC += 1;
-
-		//Set its cycles
-		cycles = 1;
+		ram->writeByte_RAW(ACC, 0xFF);
+		FLAG_setOV();
 	}
-	//RORC
-	else if(opcode == 0xD0)
-	{
-		byte ACC_data = ram->readByte_RAW(ACC);
-		byte PSW_data = ram->readByte_RAW(PSW);
-
-		byte LSB1 = ((ACC_data & 0x1) << 7) & 0x80;
-		byte LSB2 = (PSW_data & 0x80); //No need to shift
 
-		PSW_data &= 0x7F;
-		PSW_data |= LSB1;
-		ram->writeByte(PSW, PSW_data);
-
-		ACC_data >>= 1;
-		ACC_data &= 0x7F;    //Just to make sure
-		ACC_data |= LSB2;
+	//Flags
+	FLAG_clearCY();
+}
 
-		ram->writeByte_RAW(ACC, ACC_data);
+//AND i8
+void VE_VMS_CPU::op_AND_i8(const VE_VMS_INSTRUCTION &inst)
+{
+	byte ACC_data = ram->readByte_RAW(ACC);
 
-		//Instruction pointer
-		PC += 1;
+	ACC_data &= inst.i8;
 
-		//Set its cycles
-		cycles = 1;
-	}
-	//LD d9
-	else if(opcode == 0x02 || opcode == 0x03)
-	{
-		ram->writeByte_RAW(ACC, ram->readByte(getAddress_d9()));
-
-		//Instruction pointer
-		PC += 2;
+	ram->writeByte_RAW(ACC, ACC_data);
+}
 
-		//Set its cycles
-		cycles = 1;
-	}
-	//LD @R
-	else if(opcode >= 0x04 && opcode <= 0x07)
-	{
-		ram->writeByte_RAW(ACC, ram->readByte(getAddress_R()));
+//AND d9
+void VE_VMS_CPU::op_AND_d9(const VE_VMS_INSTRUCTION &inst)
+{
+	byte operand = ram->readByte(inst.d9);
+	byte ACC_data = ram->readByte_RAW(ACC);
 
-		//Instruction pointer
-		PC += 1;
+	ACC_data &= operand;
 
-		//Set its cycles
-		cycles = 1;
-	}
-	//ST d9
-	else if(opcode == 0x12 || opcode == 0x13)
-	{
-		ram->writeByte(getAddress_d9(), ram->readByte(ACC));
+	ram->writeByte_RAW(ACC, ACC_data);
+}
 
-		//Instruction pointer
-		PC += 2;
+//AND @R
+void VE_VMS_CPU::op_AND_R(const VE_VMS_INSTRUCTION &inst)
+{
+	byte operand = ram->readByte(getAddress_R(inst.Ri));
+	byte ACC_data = ram->readByte_RAW(ACC);
 
-		//Set its cycles
-		cycles = 1;
-	}
-	//ST @R
-	else if(opcode >= 0x14 && opcode <= 0x17)
-	{
-		size_t address = getAddress_R();
-		ram->writeByte(address, ram->readByte(ACC));
+	ACC_data &= operand;
 
-		//Instruction pointer
-		PC += 1;
+	ram->writeByte_RAW(ACC, ACC_data);
+}
 
-		//Set its cycles
-		cycles = 1;
-	}
-	//MOV d9
-	else if(opcode == 0x22 || opcode == 0x23)
-	{
-		byte operand = readByteRF(PC + 2);
+//OR i8
+void VE_VMS_CPU::op_OR_i8(const VE_VMS_INSTRUCTION &inst)
+{
+	byte ACC_data = ram->readByte_RAW(ACC);
 
-		ram->writeByte(getAddress_d9(), operand);
+	ACC_data |= inst.i8;
 
-		//Instruction pointer
-		PC += 3;
+	ram->writeByte_RAW(ACC, ACC_data);
+}
 
-		//Set its cycles
-		cycles = 2;
-	}
-	//MOV @R
-	else if(opcode >= 0x24 && opcode <= 0x27)
-	{
-		byte operand = getAddress_i8();
+//OR d9
+void VE_VMS_CPU::op_OR_d9(const VE_VMS_INSTRUCTION &inst)
+{
+	byte operand = ram->readByte(inst.d9);
+	byte ACC_data = ram->readByte_RAW(ACC);
 
-		ram->writeByte(getAddress_R(), operand);
+	ACC_data |= operand;
 
-		//Instruction pointer
-		PC += 2;
+	ram->writeByte_RAW(ACC, ACC_data);
+}
 
-		//Set its cycles
-		cycles = 1;
-	}
-	//LDC
-	else if(opcode == 0xC1)
-	{
-		byte ACC_data = ram->readByte_RAW(ACC);
-		size_t address = ram->readByte(TRL) | (ram->readByte(TRH) << 8);
+//OR @R
+void VE_VMS_CPU::op_OR_R(const VE_VMS_INSTRUCTION &inst)
+{
+	byte operand = ram->readByte(getAddress_R(inst.Ri));
+	byte ACC_data = ram->readByte_RAW(ACC);
 
-		address += ACC_data;
+	ACC_data |= operand;
 
-		byte data = readByteRF(address);
+	ram->writeByte_RAW(ACC, ACC_data);
+}
 
-		ram->writeByte_RAW(ACC, data);
+//XOR i8
+void VE_VMS_CPU::op_XOR_i8(const VE_VMS_INSTRUCTION &inst)
+{
+	byte ACC_data = ram->readByte_RAW(ACC);
 
-		//Instruction pointer
-		PC += 1;
+	ACC_data ^= inst.i8;
 
-		//Set its cycles
-		cycles = 2;
-	}
-	//PUSH d9
-	else if(opcode == 0x60 || opcode == 0x61)
-	{
-		//Increase SP by 1
-		byte operand = ram->readByte(getAddress_d9());
+	ram->writeByte_RAW(ACC, ACC_data);
+}
 
-		ram->stackPush(operand);
+//XOR d9
+void VE_VMS_CPU::op_XOR_d9(const VE_VMS_INSTRUCTION &inst)
+{
+	byte operand = ram->readByte(inst.d9);
+	byte ACC_data = ram->readByte_RAW(ACC);
 
-		//Instruction pointer
-		PC += 2;
+	ACC_data ^= operand;
 
-		//Set its cycles
-		cycles = 2;
-	}
-	//POP d9
-	else if(opcode == 0x70 || opcode == 0x71)
-	{
-		size_t address = getAddress_d9();
+	ram->writeByte_RAW(ACC, ACC_data);
+}
 
-		ram->writeByte(address, ram->stackPop());
+//XOR @R
+void VE_VMS_CPU::op_XOR_R(const VE_VMS_INSTRUCTION &inst)
+{
+	byte operand = ram->readByte(getAddress_R(inst.Ri));
+	byte ACC_data = ram->readByte_RAW(ACC);
 
-		//Instruction pointer
-		PC += 2;
+	ACC_data ^= operand;
 
-		//Set its cycles
-		cycles = 2;
-	}
-	//XCHG d9
-	else if(opcode == 0xC2 || opcode == 0xC3)
-	{
-		byte ACC_data = ram->readByte_RAW(ACC);
+	ram->writeByte_RAW(ACC, ACC_data);
+}
 
-		size_t address = getAddress_d9();
-		byte operand = ram->readByte(address);
+//ROL
+void VE_VMS_CPU::op_ROL(const VE_VMS_INSTRUCTION &inst)
+{
+	byte ACC_data = ram->readByte_RAW(ACC);
 
-		ram->writeByte_RAW(ACC, operand);
-		ram->writeByte(address, ACC_data);
+	byte MSB = ((ACC_data & 0x80) >> 7);
 
-		//Instruction pointer
-		PC += 2;
+	ACC_data <<= 1;
+	ACC_data &= 0xFE;
+	ACC_data |= MSB;
 
-		//Set its cycles
-		cycles = 1;
-	}
-	//XCHG @R
-	else if(opcode >= 0xC4 && opcode <= 0xC7)
-	{
-		byte ACC_data = ram->readByte_RAW(ACC);
+	ram->writeByte_RAW(ACC, ACC_data);
+}
 
-		size_t address = getAddress_R();
-		byte operand = ram->readByte(address);
+//ROLC
+void VE_VMS_CPU::op_ROLC(const VE_VMS_INSTRUCTION &inst)
+{
+	byte ACC_data = ram->readByte_RAW(ACC);
 
-		ram->writeByte_RAW(ACC, operand);
-		ram->writeByte(address, ACC_data);
+	byte MSB1 = (ACC_data & 0x80);   //No need to shift since it will be copied to 8th bit of PSW (CY flag)
+	ram->syncFlags();
+	byte MSB2 = ((ram->readByte_RAW(PSW) & 0x80) >> 7);
 
-		//Instruction pointer
-		PC += 1;
+	byte PSW_data = ram->readByte_RAW(PSW);
+	PSW_data &= 0x7F;
+	PSW_data |= MSB1;
+	ram->writeByte(PSW, PSW_data);
 
-		//Set its cycles
-		cycles = 1;
-	}
-	//JMP a12
-	else if((opcode >= 0x28 && opcode <= 0x2F) || (opcode >= 0x38 && opcode <= 0x3F))
-	{
-		size_t address = getAddress_a12();
-		uint16_t PC_MSN = (PC+2) & 0xF000;   //Take most significant nibble from PC+2 (High 4-bits), +2 because we are calculating from the address of the next instruction.
-		address |= PC_MSN;
+	ACC_data <<= 1;
+	ACC_data &= 0xFE;    //Just to make sure
+	ACC_data |= MSB2;
 
-		PC = address;
+	ram->writeByte_RAW(ACC, ACC_data);
+}
 
-		//Set its cycles
-		cycles = 2;
-	}
-	//JMPF a16
-	else if(opcode == 0x21)
-	{
-		PC = getAddress_a16();
+//ROR
+void VE_VMS_CPU::op_ROR(const VE_VMS_INSTRUCTION &inst)
+{
+	byte ACC_data = ram->readByte_RAW(ACC);
 
-		//Set its cycles
-		cycles = 2;
-	}
-	//BR r8
-	else if(opcode == 0x01)
-	{
-		//Branch unconditionally
-		signed char address = getAddress_r8();
+	byte LSB = ((ACC_data & 0x1) << 7) & 0x80;
 
-		//Instruction pointer
-		PC += 2;
-		PC += address;
+	ACC_data >>= 1;
+	ACC_data &= 0x7F;    //To set MSB to 0
+	ACC_data |= LSB;
 
-		//Set its cycles
-		cycles = 2;
-	}
-	//BRF r16
-	else if(opcode == 0x11)
-	{
-		size_t address = getAddress_r16();
+	ram->writeByte_RAW(ACC, ACC_data);
+}
 
-		//Instruction pointer
-		PC += 2; //3-1
-		PC = (PC + address) % 0x10000;  //Any extra bits after 0xFFFF are removed. e.g. 0x10001 becomes 1
+//RORC
+void VE_VMS_CPU::op_RORC(const VE_VMS_INSTRUCTION &inst)
+{
+	byte ACC_data = ram->readByte_RAW(ACC);
+	ram->syncFlags();
+	byte PSW_data = ram->readByte_RAW(PSW);
 
-		//Set its cycles
-		cycles = 4;
-	}
-	//BZ r8
-	else if(opcode == 0x80)
-	{
-		signed char address = getAddress_r8();
+	byte LSB1 = ((ACC_data & 0x1) << 7) & 0x80;
+	byte LSB2 = (PSW_data & 0x80); //No need to shift
 
-		//Instruction pointer
-		PC += 2;
-		if(ram->readByte(ACC) == 0x00) PC += address;
+	PSW_data &= 0x7F;
+	PSW_data |= LSB1;
+	ram->writeByte(PSW, PSW_data);
 
-		//Set its cycles
-		cycles = 2;
-	}
-	//BNZ r8
-	else if(opcode == 0x90)
-	{
-		signed char address = getAddress_r8();
+	ACC_data >>= 1;
+	ACC_data &= 0x7F;    //Just to make sure
+	ACC_data |= LSB2;
 
-		//Instruction pointer
-		PC += 2;
-		if(ram->readByte(ACC) != 0x00) PC += address;;
+	ram->writeByte_RAW(ACC, ACC_data);
+}
 
-		//Set its cycles
-		cycles = 2;
-	}
-	//BP d9,b3,r8
-	else if((opcode >= 0x68 && opcode <= 0x6F) || (opcode >= 0x78 && opcode <= 0x7F))
-	{
-		byte bits = getAddress_b3();
-		size_t op_address = getAddress_d9_b3();
-		signed char address = getAddress_r8_b3();
+//LD d9
+void VE_VMS_CPU::op_LD_d9(const VE_VMS_INSTRUCTION &inst)
+{
+	ram->writeByte_RAW(ACC, ram->readByte(inst.d9));
+}
 
-		byte operand = ram->readByte(op_address);
+//LD @R
+void VE_VMS_CPU::op_LD_R(const VE_VMS_INSTRUCTION &inst)
+{
+	ram->writeByte_RAW(ACC, ram->readByte(getAddress_R(inst.Ri)));
+}
 
-		PC += 3;
+//ST d9
+void VE_VMS_CPU::op_ST_d9(const VE_VMS_INSTRUCTION &inst)
+{
+	ram->writeByte(inst.d9, ram->readByte(ACC));
+}
 
-		//Do test (Just shift the bit to be LSB, then AND the result to get only that bit ;) )
-		if(((operand >> bits) & 0x1) != 0)
-			PC += address;
+//ST @R
+void VE_VMS_CPU::op_ST_R(const VE_VMS_INSTRUCTION &inst)
+{
+	size_t address = getAddress_R(inst.Ri);
+	ram->writeByte(address, ram->readByte(ACC));
+}
 
-		//Set its cycles
-		cycles = 2;
-	}
-	//BPC d9,b3,r8
-	else if((opcode >= 0x48 && opcode <= 0x4F) || (opcode >= 0x58 && opcode <= 0x5F))
-	{
-		byte bits = getAddress_b3();
-		size_t op_address = getAddress_d9_b3();
-		signed char address = getAddress_r8_b3();
+//MOV d9
+void VE_VMS_CPU::op_MOV_d9(const VE_VMS_INSTRUCTION &inst)
+{
+	ram->writeByte(inst.d9, inst.i8);
+}
 
-		byte operand = ram->readByte(op_address);
+//MOV @R
+void VE_VMS_CPU::op_MOV_R(const VE_VMS_INSTRUCTION &inst)
+{
+	ram->writeByte(getAddress_R(inst.Ri), inst.i8);
+}
 
-		PC += 3;
+//LDC
+void VE_VMS_CPU::op_LDC(const VE_VMS_INSTRUCTION &inst)
+{
+	byte ACC_data = ram->readByte_RAW(ACC);
+	size_t address = ram->readByte(TRL) | (ram->readByte(TRH) << 8);
 
-		//Do test (Just shift the bit to be LSB, then AND the result to get only that bit ;) )
-		byte temp = ((operand >> bits) & 0x1); //00000001
-		if(temp != 0) 
-		{
-			//We want to clear that bit before we branch
-			temp <<= bits;    //00001000
-			temp = (~temp) & 0xFF; //11110111  (Now we AND this with the original operand)
-			operand &= temp;
+	address += ACC_data;
 
-			ram->writeByte(op_address, operand);
+	byte data = readByteRF(address);
 
-			PC += address;
-		}
+	ram->writeByte_RAW(ACC, data);
+}
 
-		//Set its cycles
-		cycles = 2;
-	}
-	//BN d9,b3,r8
-	else if((opcode >= 0x88 && opcode <= 0x8F) || (opcode >= 0x98 && opcode <= 0x9F))
-	{
-		byte bits = getAddress_b3();
-		size_t op_address = getAddress_d9_b3();
-		signed char address = getAddress_r8_b3();
+//PUSH d9
+void VE_VMS_CPU::op_PUSH(const VE_VMS_INSTRUCTION &inst)
+{
+	//Increase SP by 1
+	byte operand = ram->readByte(inst.d9);
 
-		byte operand = ram->readByte(op_address);
+	ram->stackPush(operand);
+}
 
-		PC += 3;
+//POP d9
+void VE_VMS_CPU::op_POP(const VE_VMS_INSTRUCTION &inst)
+{
+	ram->writeByte(inst.d9, ram->stackPop());
+}
 
-		//Do test (Just shift the bit to be LSB, then AND the result to get only that bit ;) )
-		if(((operand >> bits) & 0x1) == 0)
-			PC += address;
+//XCHG d9
+void VE_VMS_CPU::op_XCH_d9(const VE_VMS_INSTRUCTION &inst)
+{
+	byte ACC_data = ram->readByte_RAW(ACC);
 
-		//Set its cycles
-		cycles = 2;
-	}
-	//DBNZ d9,r8
-	else if(opcode == 0x52 || opcode == 0x53)
-	{
-		size_t op_address = getAddress_d9();
-		signed char address = getAddress_r8_b3(); //Just because r8 is the second parameter
+	byte operand = ram->readByte(inst.d9);
 
-		byte operand = ram->readByte(op_address);
-		operand--;
-		operand &= 0xFF;
+	ram->writeByte_RAW(ACC, operand);
+	ram->writeByte(inst.d9, ACC_data);
+}
 
-		ram->writeByte(op_address, operand);
+//XCHG @R
+void VE_VMS_CPU::op_XCH_R(const VE_VMS_INSTRUCTION &inst)
+{
+	byte ACC_data = ram->readByte_RAW(ACC);
 
-		PC += 3;
+	size_t address = getAddress_R(inst.Ri);
+	byte operand = ram->readByte(address);
 
-		if(operand != 0)
-			PC += address;
+	ram->writeByte_RAW(ACC, operand);
+	ram->writeByte(address, ACC_data);
+}
 
-		//Set its cycles
-		cycles = 2;
-	}
-	//DBNZ @R,r8
-	else if(opcode >= 0x54 && opcode <= 0x57)
-	{
-		size_t op_address = getAddress_R();
-		signed char address = getAddress_r8();
+//JMP a12
+void VE_VMS_CPU::op_JMP(const VE_VMS_INSTRUCTION &inst)
+{
+	uint16_t PC_MSN = PC & 0xF000;   //Take most significant nibble from the address of the next instruction (High 4-bits).
 
-		byte operand = ram->readByte(op_address);
-		operand--;
-		operand &= 0xFF;
+	PC = inst.a16 | PC_MSN;
+}
 
-		ram->writeByte(op_address, operand);
+//JMPF a16
+void VE_VMS_CPU::op_JMPF(const VE_VMS_INSTRUCTION &inst)
+{
+	PC = inst.a16;
+}
 
-		PC += 2;
+//BR r8
+void VE_VMS_CPU::op_BR(const VE_VMS_INSTRUCTION &inst)
+{
+	//Branch unconditionally
+	PC = (PC + inst.r8) & 0xFFFF;
+}
 
-		if(operand != 0)
-			PC += address;
+//BRF r16
+void VE_VMS_CPU::op_BRF(const VE_VMS_INSTRUCTION &inst)
+{
+	//Relative to the last byte of the instruction (3-1)
+	PC = (PC - 1 + inst.a16) % 0x10000;  //Any extra bits after 0xFFFF are removed. e.g. 0x10001 becomes 1
+}
 
-		//Set its cycles
-		cycles = 2;
-	}
-	//BE i8, r8
-	else if(opcode == 0x31)
-	{
-		byte operand = getAddress_i8();
-		byte ACC_data = ram->readByte_RAW(ACC);
+//BZ r8
+void VE_VMS_CPU::op_BZ(const VE_VMS_INSTRUCTION &inst)
+{
+	if(ram->readByte(ACC) == 0x00) PC = (PC + inst.r8) & 0xFFFF;
+}
 
-		signed char address = getAddress_r8_b3();
+//BNZ r8
+void VE_VMS_CPU::op_BNZ(const VE_VMS_INSTRUCTION &inst)
+{
+	if(ram->readByte(ACC) != 0x00) PC = (PC + inst.r8) & 0xFFFF;
+}
 
-		PC += 3;
+//BP d9,b3,r8
+void VE_VMS_CPU::op_BP(const VE_VMS_INSTRUCTION &inst)
+{
+	byte operand = ram->readByte(inst.d9);
 
-		if(operand == ACC_data)
-			PC += address;
+	//Do test (Just shift the bit to be LSB, then AND the result to get only that bit ;) )
+	if(((operand >> inst.b3) & 0x1) != 0)
+		PC = (PC + inst.r8) & 0xFFFF;
+}
 
-		if(ACC_data < operand) FLAG_setCY(); else FLAG_clearCY();
+//BPC d9,b3,r8
+void VE_VMS_CPU::op_BPC(const VE_VMS_INSTRUCTION &inst)
+{
+	byte operand = ram->readByte(inst.d9);
 
-		//Set its cycles
-		cycles = 2;
-	}
-	//BE d9, r8
-	else if(opcode == 0x32 || opcode == 0x33)
+	//Do test (Just shift the bit to be LSB, then AND the result to get only that bit ;) )
+	byte temp = ((operand >> inst.b3) & 0x1); //00000001
+	if(temp != 0) 
 	{
-		size_t op_address = getAddress_d9();
-		byte operand = ram->readByte(op_address);
-
-		byte ACC_data = ram->readByte_RAW(ACC);
-
-		signed char address = getAddress_r8_b3();
-
-		PC += 3;
-
-		if(operand == ACC_data)
-			PC += address;
+		//We want to clear that bit before we branch
+		temp <<= inst.b3;    //00001000
+		temp = (~temp) & 0xFF; //11110111  (Now we AND this with the original operand)
+		operand &= temp;
 
-		if(ACC_data < operand) FLAG_setCY(); else FLAG_clearCY();
+		ram->writeByte(inst.d9, operand);
 
-		//Set its cycles
-		cycles = 2;
+		PC = (PC + inst.r8) & 0xFFFF;
 	}
-	//BE @R, i8, r8
-	else if(opcode >= 0x34 && opcode <= 0x37)
-	{
-		size_t op_address = getAddress_R();
-		byte operand1 = ram->readByte(op_address);
-		byte operand2 = getAddress_i8();
-		signed char address = getAddress_r8_b3();
-
-		PC += 3;
-
-		if(operand1 == operand2)
-			PC += address;
+}
 
-		if(operand1 < operand2) FLAG_setCY(); else FLAG_clearCY();
+//BN d9,b3,r8
+void VE_VMS_CPU::op_BN(const VE_VMS_INSTRUCTION &inst)
+{
+	byte operand = ram->readByte(inst.d9);
 
-		//Set its cycles
-		cycles = 2;
-	}
-	//BNE i8, r8
-	else if(opcode == 0x41)
-	{
-		byte operand = getAddress_i8();
-		byte ACC_data = ram->readByte_RAW(ACC);
+	//Do test (Just shift the bit to be LSB, then AND the result to get only that bit ;) )
+	if(((operand >> inst.b3) & 0x1) == 0)
+		PC = (PC + inst.r8) & 0xFFFF;
+}
 
-		signed char address = getAddress_r8_b3();
+//DBNZ d9,r8
+void VE_VMS_CPU::op_DBNZ_d9(const VE_VMS_INSTRUCTION &inst)
+{
+	byte operand = ram->readByte(inst.d9);
+	operand--;
+	operand &= 0xFF;
 
-		PC += 3;
+	ram->writeByte(inst.d9, operand);
 
-		if(operand != ACC_data)
-			PC += address;
+	if(operand != 0)
+		PC = (PC + inst.r8) & 0xFFFF;
+}
 
-		if(ACC_data < operand) FLAG_setCY(); else FLAG_clearCY();
+//DBNZ @R,r8
+void VE_VMS_CPU::op_DBNZ_R(const VE_VMS_INSTRUCTION &inst)
+{
+	size_t op_address = getAddress_R(inst.Ri);
 
-		//Set its cycles
-		cycles = 2;
-	}
-	//BNE d9, r8
-	else if(opcode == 0x42 || opcode == 0x43)
-	{
-		size_t op_address = getAddress_d9();
-		byte operand = ram->readByte(op_address) & 0xFF;
+	byte operand = ram->readByte(op_address);
+	operand--;
+	operand &= 0xFF;
 
-		byte ACC_data = ram->readByte_RAW(ACC);
+	ram->writeByte(op_address, operand);
 
-		signed char address = getAddress_r8_b3();
+	if(operand != 0)
+		PC = (PC + inst.r8) & 0xFFFF;
+}
 
-		PC += 3;
+//BE i8, r8
+void VE_VMS_CPU::op_BE_i8(const VE_VMS_INSTRUCTION &inst)
+{
+	byte ACC_data = ram->readByte_RAW(ACC);
 
-		if(operand != ACC_data)
-			PC += address;
+	if(inst.i8 == ACC_data)
+		PC = (PC + inst.r8) & 0xFFFF;
 
-		if(ACC_data < operand) FLAG_setCY(); else FLAG_clearCY();
+	if(ACC_data < inst.i8) FLAG_setCY(); else FLAG_clearCY();
+}
 
-		//Set its cycles
-		cycles = 2;
-	}
-	//BNE @R, i8, r8
-	else if(opcode >= 0x44 && opcode <= 0x47)
-	{
-		size_t op_address = getAddress_R();
-		byte operand1 = ram->readByte(op_address) & 0xFF;
-		byte operand2 = getAddress_i8();
+//BE d9, r8
+void VE_VMS_CPU::op_BE_d9(const VE_VMS_INSTRUCTION &inst)
+{
+	byte operand = ram->readByte(inst.d9);
 
-		signed char address = getAddress_r8_b3();
+	byte ACC_data = ram->readByte_RAW(ACC);
 
-		PC += 3;
+	if(operand == ACC_data)
+		PC = (PC + inst.r8) & 0xFFFF;
 
-		if(operand1 != operand2)
-			PC += address;
+	if(ACC_data < operand) FLAG_setCY(); else FLAG_clearCY();
+}
 
-		if(operand1 < operand2) FLAG_setCY(); else FLAG_clearCY();
+//BE @R, i8, r8
+void VE_VMS_CPU::op_BE_R(const VE_VMS_INSTRUCTION &inst)
+{
+	byte operand1 = ram->readByte(getAddress_R(inst.Ri));
 
-		//Set its cycles
-		cycles = 2;
-	}
-	//CALL a12
-	else if((opcode >= 0x08 && opcode <= 0x0F) || (opcode >= 0x18 && opcode <= 0x1F))
-	{
-		size_t address = getAddress_a12();
-		PC += 2;
-		uint16_t PC_MSN = PC & 0xF000;   //Take most significant nibble from PC+2 (High 4-bits), +2 because we are calculating from the address of the next instruction.
-		address |= PC_MSN;
+	if(operand1 == inst.i8)
+		PC = (PC + inst.r8) & 0xFFFF;
 
-		//Push address (Of next instruction) on stack
-		byte LSB = (PC & 0xFF);
-		byte MSB = ((PC & 0xFF00) >> 8);
+	if(operand1 < inst.i8) FLAG_setCY(); else FLAG_clearCY();
+}
 
-		ram->stackPush(LSB);
-		ram->stackPush(MSB);
+//BNE i8, r8
+void VE_VMS_CPU::op_BNE_i8(const VE_VMS_INSTRUCTION &inst)
+{
+	byte ACC_data = ram->readByte_RAW(ACC);
 
-		//Jump to address
-		PC = address;
+	if(inst.i8 != ACC_data)
+		PC = (PC + inst.r8) & 0xFFFF;
 
-		//Set its cycles
-		cycles = 2;
-	}
-	//CALLF a16
-	else if(opcode == 0x20)
-	{
-		size_t address = getAddress_a16();
+	if(ACC_data < inst.i8) FLAG_setCY(); else FLAG_clearCY();
+}
 
-		PC += 3;
-		//Push address (Of next instruction) on stack
-		byte LSB = (PC & 0xFF);
-		byte MSB = ((PC & 0xFF00) >> 8);
+//BNE d9, r8
+void VE_VMS_CPU::op_BNE_d9(const VE_VMS_INSTRUCTION &inst)
+{
+	byte operand = ram->readByte(inst.d9) & 0xFF;
 
-		ram->stackPush(LSB);
-		ram->stackPush(MSB);
+	byte ACC_data = ram->readByte_RAW(ACC);
 
-		PC = address;
+	if(operand != ACC_data)
+		PC = (PC + inst.r8) & 0xFFFF;
 
-		//Set its cycles
-		cycles = 2;
-	}
-	//CALLR r16
-	else if(opcode == 0x10)
-	{
-		size_t address = getAddress_r16();
+	if(ACC_data < operand) FLAG_setCY(); else FLAG_clearCY();
+}
 
-		//Push address (Of next instruction) on stack
-		PC += 3;
-		byte LSB = (PC & 0xFF);
-		byte MSB = ((PC & 0xFF00) >> 8);
+//BNE @R, i8, r8
+void VE_VMS_CPU::op_BNE_R(const VE_VMS_INSTRUCTION &inst)
+{
+	byte operand1 = ram->readByte(getAddress_R(inst.Ri)) & 0xFF;
 
-		ram->stackPush(LSB);
-		ram->stackPush(MSB);
+	if(operand1 != inst.i8)
+		PC = (PC + inst.r8) & 0xFFFF;
 
-		PC -= 1;
-		//Instruction pointer
-		PC = (PC + address) % 0x10000;  //Any extra bits after 0xFFFF are removed. e.g. 0x10001 becomes 1
-		//2 = 3 - 1 (Instruction after - 1)
+	if(operand1 < inst.i8) FLAG_setCY(); else FLAG_clearCY();
+}
 
-		//Set its cycles
-		cycles = 4;
-	}
-	//RET
-	else if(opcode == 0xA0)
-	{
-		//Get back to PC which we stored in stack when call occurred.
-		//And of course decrease SP
-		byte PC1 = ram->stackPop();    //High bits
-		byte PC2 = ram->stackPop();    //Low bits
+//CALL a12
+void VE_VMS_CPU::op_CALL(const VE_VMS_INSTRUCTION &inst)
+{
+	uint16_t PC_MSN = PC & 0xF000;   //Take most significant nibble from the address of the next instruction (High 4-bits).
 
-		PC = PC2 | (PC1 << 8);
+	//Push address (Of next instruction) on stack
+	byte LSB = (PC & 0xFF);
+	byte MSB = ((PC & 0xFF00) >> 8);
 
-		//Set its cycles
-		cycles = 2;
-	}
-	//RETI
-	else if(opcode == 0xB0)
-	{
-		//Get back to PC which we stored in stack when interrupt occurred.
-		//And of course decrease SP
-		byte PC1 = ram->stackPop();    //High bits
-		byte PC2 = ram->stackPop();    //Low bits
+	ram->stackPush(LSB);
+	ram->stackPush(MSB);
 
-		PC = PC2 | (PC1 << 8);
+	//Jump to address
+	PC = inst.a16 | PC_MSN;
+}
 
-		//Handle interrupts
-		if(interruptLevel > 0) interruptLevel--;
+//CALLF a16
+void VE_VMS_CPU::op_CALLF(const VE_VMS_INSTRUCTION &inst)
+{
+	//Push address (Of next instruction) on stack
+	byte LSB = (PC & 0xFF);
+	byte MSB = ((PC & 0xFF00) >> 8);
 
-		int interruptReturned = interruptQueue.back();
-		interruptQueue.pop_back();
-		
-		//printf("RETI %d\n", interruptReturned);
+	ram->stackPush(LSB);
+	ram->stackPush(MSB);
 
+	PC = inst.a16;
+}
 
-		if(interruptReturned == 10) P3_taken = true;
-		//if(interruptReturned == 5) printf("Exited T0HOV\n");
-		//if(interruptReturned == 4) intHandler->BT_Taken = true;
+//CALLR r16
+void VE_VMS_CPU::op_CALLR(const VE_VMS_INSTRUCTION &inst)
+{
+	//Push address (Of next instruction) on stack
+	byte LSB = (PC & 0xFF);
+	byte MSB = ((PC & 0xFF00) >> 8);
 
-		currentInterrupt = 0;
+	ram->stackPush(LSB);
+	ram->stackPush(MSB);
 
-		//Re-accept interrupts
-		//interruptsMasked = false;
+	//Relative to the last byte of the instruction (3-1)
+	PC = (PC - 1 + inst.a16) % 0x10000;  //Any extra bits after 0xFFFF are removed. e.g. 0x10001 becomes 1
+}
 
+//RET
+void VE_VMS_CPU::op_RET(const VE_VMS_INSTRUCTION &inst)
+{
+	//Get back to PC which we stored in stack when call occurred.
+	//And of course decrease SP
+	byte PC1 = ram->stackPop();    //High bits
+	byte PC2 = ram->stackPop();    //Low bits
 
-		//Set back 'currentInterrupt' to the other active highest priority interrupt
-		/*byte IE = ram->readByte(IE); //Interrupt Enable control
+	PC = PC2 | (PC1 << 8);
+}
 
-		if((IE & 128) != 0) {
-			if (intHandler->getINT0() == 1) currentInterrupt = 1;
-			else if (intHandler->getINT1() == 1) currentInterrupt = 2;
-			else if (intHandler->getINT2() == 1) currentInterrupt = 3;
-			else if (intHandler->getINT3() == 1) currentInterrupt = 4;
-			else if (intHandler->getT0HOV() == 1) currentInterrupt = 5;
-			else if (intHandler->getT1HLOV() == 1) currentInterrupt = 6;
-			else if (intHandler->getSIO0() == 1) currentInterrupt = 7;
-			else if (intHandler->getSIO1() == 1) currentInterrupt = 8;
-			else if (intHandler->getRFB() == 1) currentInterrupt = 9;
-			else if (intHandler->getP3() == 1) currentInterrupt = 10;
-		}
-		else{
-			if((IE & 1) == 0)
-			{
-				if (intHandler->getINT0() == 1) currentInterrupt = 1;
+//RETI
+void VE_VMS_CPU::op_RETI(const VE_VMS_INSTRUCTION &inst)
+{
+	//Get back to PC which we stored in stack when interrupt occurred.
+	//And of course decrease SP
+	byte PC1 = ram->stackPop();    //High bits
+	byte PC2 = ram->stackPop();    //Low bits
 
-				if((IE & 2) == 0) {
-					if (intHandler->getINT1() == 1) currentInterrupt = 2;
-				}
-			}
-		}*/
+	PC = PC2 | (PC1 << 8);
 
-		//Set its cycles
-		cycles = 2;
-	}
-	//CLR1 d9, b3
-	else if((opcode >= 0xC8 && opcode <= 0xCF) || (opcode >= 0xD8 && opcode <= 0xDF)) 
+	//Handle interrupts, RETI outside of an interrupt has nothing to return from
+	if(interruptLevel > 0)
 	{
-		size_t op_address = getAddress_d9_b3();
-		byte operand = ram->readByte(op_address);
-		byte bits = getAddress_b3();
-
-		byte temp = 1; //00000001
-		//We want to clear that bit
-		temp <<= bits;    //00001000
-		temp = (~temp) & 0xFF; //11110111  (Now we AND this with the original operand)
-		operand &= temp;
-
-		ram->writeByte(op_address, operand);
+		interruptLevel--;
 
-		//Instruction pointer
-		PC += 2;
-
-		//Set its cycles
-		cycles = 1;
+		if(interruptLevel < INTERRUPT_STACK_DEPTH && interruptStack[interruptLevel] == INT_P3) P3_taken = true;
 	}
-	//SET1 d9, b3
-	else if((opcode >= 0xE8 && opcode <= 0xEF) || (opcode >= 0xF8 && opcode <= 0xFF)) 
-	{
-		size_t op_address = getAddress_d9_b3();
-		byte operand = ram->readByte(op_address);
-		byte bits = getAddress_b3();
-
-		byte temp = (1 << bits); //00001000 (Now we OR this with the original operand)
-		//We want to set that bit
-		operand |= temp;
-
-		ram->writeByte(op_address, operand);
 
-		//Instruction pointer
-		PC += 2;
-
-		//Set its cycles
-		cycles = 1;
-	}
-	//NOT1 d9, b3
-	else if((opcode >= 0xA8 && opcode <= 0xAF) || (opcode >= 0xB8 && opcode <= 0xBF)) 
-	{
-		size_t op_address = getAddress_d9_b3();
-		byte operand = ram->readByte(op_address);
-		byte bits = getAddress_b3();
+	currentInterrupt = 0;
+}
 
-		byte temp = (1 << bits); //00001000
-		//We want to set that bit
-		if(((operand >> bits) & 0x1) == 0) 
-		{
-			//00001000 (Now we OR this with the original operand)
-			operand |= temp;
-		}
-		else
-		{
-			temp = (~temp) & 0xFF; //11110111  (Now we AND this with the original operand)
-			operand &= temp;
-		}
-		ram->writeByte(op_address, operand);
+//CLR1 d9, b3
+void VE_VMS_CPU::op_CLR1(const VE_VMS_INSTRUCTION &inst)
+{
+	byte operand = ram->readByte(inst.d9);
 
-		//Instruction pointer
-		PC += 2;
+	byte temp = 1; //00000001
+	//We want to clear that bit
+	temp <<= inst.b3;    //00001000
+	temp = (~temp) & 0xFF; //11110111  (Now we AND this with the original operand)
+	operand &= temp;
 
-		//Set its cycles
-		cycles = 1;
-	}
-	//Special low level opcodes
-	//LDC Flash
-	else if(opcode == 0x50)
-	{
-		byte ACC_data = ram->readByte_RAW(ACC);
-		size_t address = ram->readByte(TRL) | (ram->readByte(TRH) << 8);
+	ram->writeByte(inst.d9, operand);
+}
 
-		//address += ACC_data;
+//SET1 d9, b3
+void VE_VMS_CPU::op_SET1(const VE_VMS_INSTRUCTION &inst)
+{
+	byte operand = ram->readByte(inst.d9);
 
-		byte data = flash->readByte(address);
+	byte temp = (1 << inst.b3); //00001000 (Now we OR this with the original operand)
+	//We want to set that bit
+	operand |= temp;
 
-		ram->writeByte_RAW(ACC, data);
+	ram->writeByte(inst.d9, operand);
+}
 
-		//Instruction pointer
-		PC += 1;
+//NOT1 d9, b3
+void VE_VMS_CPU::op_NOT1(const VE_VMS_INSTRUCTION &inst)
+{
+	byte operand = ram->readByte(inst.d9);
 
-		//Set its cycles
-		cycles = 2;
+	byte temp = (1 << inst.b3); //00001000
+	//We want to set that bit
+	if(((operand >> inst.b3) & 0x1) == 0) 
+	{
+		//00001000 (Now we OR this with the original operand)
+		operand |= temp;
 	}
-	//STC Flash
-	else if(opcode == 0x51)
+	else
 	{
-		byte ACC_data = ram->readByte_RAW(ACC);
-		size_t address = ram->readByte(TRL) | (ram->readByte(TRH) << 8);
-
-		flash->writeByte(address, ACC_data);
-
-		//Instruction pointer
-		PC += 1;
-
-		//Set its cycles
-		cycles = 2;
+		temp = (~temp) & 0xFF; //11110111  (Now we AND this with the original operand)
+		operand &= temp;
 	}
+	ram->writeByte(inst.d9, operand);
+}
 
+//Special low level opcodes
+//LDC Flash
+void VE_VMS_CPU::op_LDF(const VE_VMS_INSTRUCTION &inst)
+{
+	size_t address = ram->readByte(TRL) | (ram->readByte(TRH) << 8);
 
-	++instructionCount;
-	
-	return cycles;
+	byte data = flash->readByte(address);
 
+	ram->writeByte_RAW(ACC, data);
 }
 
+//STC Flash
+void VE_VMS_CPU::op_STF(const VE_VMS_INSTRUCTION &inst)
+{
+	byte ACC_data = ram->readByte_RAW(ACC);
+	size_t address = ram->readByte(TRL) | (ram->readByte(TRH) << 8);
+
+	flash->writeByte(address, ACC_data);
+}
@@ -19,15 +19,28 @@
 #ifndef _CPU_H_
 #define _CPU_H_
 
-#include <vector>
 #include "ram.h"
 #include "rom.h"
 #include "flash.h"
 #include "interrupts.h"
 #include "bitwisemath.h"
+#include "alu.h"
+#include "opcodes.h"
+#include "icache.h"
+#include "block.h"
+#include "busyloop.h"
+#include "policy.h"
+
+class VE_VMS_JIT;
+
+//Nested interrupts remembered for RETI
+#define INTERRUPT_STACK_DEPTH 16
 
 class VE_VMS_CPU
 {
+    //Native code works directly on CPU state
+    friend class VE_VMS_JIT;
+
 public:
 
 	int state;   //0: stopped. 1: started.
@@ -35,12 +48,12 @@ public:
     int EXTNew;
     bool P3_taken;
 
-	VE_VMS_CPU(VE_VMS_RAM *_ram, VE_VMS_ROM *_rom, VE_VMS_FLASH *_flash, VE_VMS_INTERRUPTS *_intHandler, bool hle);
+    //Busy-wait loop CPU is spinning in at PC (Caller clears it), found once a whole iteration left CPU state unchanged
+    VE_VMS_BUSYLOOP *spinning;
+
+	VE_VMS_CPU(VE_VMS_RAM *_ram, VE_VMS_ROM *_rom, VE_VMS_FLASH *_flash, VE_VMS_INTERRUPTS *_intHandler, VE_VMS_ICACHE *_icache, VE_VMS_BUSYLOOPS *_busyLoops);
 	~VE_VMS_CPU();
 	
-	double getCurrentFrequency();
-	void setFrequency(double f);
-
 	//Memory operations
 	//Reads a byte either from ROM or Flash, depending on value of EXT
 	byte readByteRF(size_t address);
@@ -49,45 +62,33 @@ public:
 	void writeByteRF(size_t address, byte d);
 	
 	
-	//Read
-	byte *readFromROM(size_t address, size_t byteCount);
-	byte *readFromRAM(size_t address, size_t byteCount);
-	
-	//Write
-	void writeToROM(byte *data, size_t dataSize, size_t address);
-	void writeToRAM(byte *data, size_t dataSize, size_t address);
+	//Bulk transfers (Caller provides buffer, banks are resolved once per call), all return bytes copied
+	//Main RAM (0x00-0xFF) in bank selected by PSW, stops at end of bank
+	size_t readRAM(size_t address, byte *out, size_t count);
+	size_t writeRAM(size_t address, const byte *in, size_t count);
+
+	//XRAM bank (0-2), offset 0x00-0x7B
+	size_t readXRAM(int bank, size_t offset, byte *out, size_t count);
+	size_t writeXRAM(int bank, size_t offset, const byte *in, size_t count);
+
+	//Work RAM, 0x000-0x1FF
+	size_t readWRAM(size_t address, byte *out, size_t count);
+	size_t writeWRAM(size_t address, const byte *in, size_t count);
+
+	//Flash, absolute address 0x00000-0x1FFFF (No banking)
+	size_t readFlash(size_t address, byte *out, size_t count);
+	size_t writeFlash(size_t address, const byte *in, size_t count);
 	
 	//Address/Data functions
-	//Immediate
-	byte getAddress_i8();
-	
-	//Relative 8-bit (signed)
-	signed char getAddress_r8();
-	
-	//Relative 8-bit when the opcode has bit specifiers (signed)
-	signed char getAddress_r8_b3();
-	
-	//Relative 16-bit
-	size_t getAddress_r16();
-	
-	//Direct 9-bit
-	size_t getAddress_d9();
-	
-	//Direct 9-bit with bit assignment
-	size_t getAddress_d9_b3();
-	
-	//Get bits (b3)
-	byte getAddress_b3();
-	
-	//Indirect
-	size_t getAddress_R();
-	
-	//Absolute 12-bit
-	size_t getAddress_a12();
-	
-	//Absolute 16-bit
-	size_t getAddress_a16();
-	
+	//Decodes instruction at address (Opcode and its operands)
+	void decodeInstruction(size_t address, VE_VMS_INSTRUCTION &inst);
+
+	//Disassembles instruction at address into out (Needs at least 32 bytes), returns instruction length
+	int disassemble(size_t address, char *out);
+
+	//Indirect (Ri is the indirection register number, taken from opcode)
+	size_t getAddress_R(byte Ri);
+
 	//Absolute 16-bit (But can select to get operand from ROM (EXT = 0) or Flash (EXT = 1), important for when an instruction changes EXT, it will always be followed by a JMPF)
 	size_t getAddress_a16(byte _EXT);
 
@@ -123,18 +124,27 @@ public:
      ******************************************************
      ******************************************************/
 
-    void processInterrupts();
+    //Returns true when an interrupt was taken
+    bool processInterrupts();
 
     void performHLE(size_t entryAddress);
 
-	//Interpreter
-    int processInstruction(bool dbg);
+	//Interpreter, returns cycles of instruction executed (System and Trace are policies, see policy.h)
+    template<class System, class Trace> int processInstruction();
+
+    //Superblock engine, runs instructions that start within maxCycles and returns cycles they took
+    template<class System, class Trace> int runBlock(int maxCycles);
+
+    //Instructions executed so far (Wraps around)
+    int getInstructionCount();
+
+    //Logs superblock statistics at debug level
+    void logBlockStats();
     
 private:
     size_t PC; //This counts where we reached in instruction memory (Starting from first instruction executed)
     int clock;   //In nanoseconds
-    double frequency;
-    int interruptLevel;
+    int interruptLevel;     //Nesting depth
     int currentInterrupt;
     bool interruptsMasked;
 
@@ -144,10 +154,121 @@ private:
     VE_VMS_ROM *rom;
     VE_VMS_FLASH *flash;
     VE_VMS_INTERRUPTS *intHandler;
+    VE_VMS_ICACHE *icache;
+    VE_VMS_BLOCKCACHE *blocks;
+    VE_VMS_BUSYLOOPS *busyLoops;
+
+    //Last arrival at head of an idle loop (State is compared on the next one)
+    VE_VMS_BUSYLOOP *spinLoop;
+    byte spinACC;
+    byte spinPSW;
+    int spinStart;  //instructionCount
     
-    std::vector<int> interruptQueue;
-    
-    bool IsHLE;
+    int interruptStack[INTERRUPT_STACK_DEPTH];
+
+    //Dispatch table, indexed by opcode
+    static const VE_VMS_HANDLER handlers[256];
+
+    //Follows EXT changes (Bank switch or HLE call)
+    template<class System> void checkEXT();
+
+    //Logs instruction at address (Instruction trace)
+    void traceInstruction(const VE_VMS_INSTRUCTION &inst, size_t address);
+
+    //Superblocks
+    VE_VMS_BLOCK *buildBlock(byte bank, size_t address);
+    VE_VMS_BLOCK *getBlock(byte bank);
+    template<class Trace> int executeBlock(VE_VMS_BLOCK *block, byte bank, int maxCycles);
+    static VE_VMS_FUSED_HANDLER findFusion(const VE_VMS_INSTRUCTION &first, const VE_VMS_INSTRUCTION &second);
+
+    //Busy-wait loops
+    void checkBusyLoop(byte bank, size_t branch);
+    void analyzeLoop(VE_VMS_BUSYLOOP &loop, byte bank, size_t head);
+
+    //Fused instruction handlers (Superinstructions)
+    void fop_LD_ST(const VE_VMS_INSTRUCTION &first, const VE_VMS_INSTRUCTION &second);
+    void fop_LD_BZ(const VE_VMS_INSTRUCTION &first, const VE_VMS_INSTRUCTION &second);
+    void fop_LD_BNZ(const VE_VMS_INSTRUCTION &first, const VE_VMS_INSTRUCTION &second);
+    void fop_LD_BE(const VE_VMS_INSTRUCTION &first, const VE_VMS_INSTRUCTION &second);
+    void fop_LD_BNE(const VE_VMS_INSTRUCTION &first, const VE_VMS_INSTRUCTION &second);
+    void fop_AND_BZ(const VE_VMS_INSTRUCTION &first, const VE_VMS_INSTRUCTION &second);
+    void fop_AND_BNZ(const VE_VMS_INSTRUCTION &first, const VE_VMS_INSTRUCTION &second);
+
+    //Arithmetic helpers (Operate on ACC and set CY, AC and OV)
+    void doADD(byte operand, byte carry);
+    void doSUB(byte operand, byte carry);
+
+    //Instruction handlers
+    void op_NOP(const VE_VMS_INSTRUCTION &inst);
+    void op_ADD_i8(const VE_VMS_INSTRUCTION &inst);
+    void op_ADD_d9(const VE_VMS_INSTRUCTION &inst);
+    void op_ADD_R(const VE_VMS_INSTRUCTION &inst);
+    void op_ADDC_i8(const VE_VMS_INSTRUCTION &inst);
+    void op_ADDC_d9(const VE_VMS_INSTRUCTION &inst);
+    void op_ADDC_R(const VE_VMS_INSTRUCTION &inst);
+    void op_SUB_i8(const VE_VMS_INSTRUCTION &inst);
+    void op_SUB_d9(const VE_VMS_INSTRUCTION &inst);
+    void op_SUB_R(const VE_VMS_INSTRUCTION &inst);
+    void op_SUBC_i8(const VE_VMS_INSTRUCTION &inst);
+    void op_SUBC_d9(const VE_VMS_INSTRUCTION &inst);
+    void op_SUBC_R(const VE_VMS_INSTRUCTION &inst);
+    void op_INC_d9(const VE_VMS_INSTRUCTION &inst);
+    void op_INC_R(const VE_VMS_INSTRUCTION &inst);
+    void op_DEC_d9(const VE_VMS_INSTRUCTION &inst);
+    void op_DEC_R(const VE_VMS_INSTRUCTION &inst);
+    void op_MUL(const VE_VMS_INSTRUCTION &inst);
+    void op_DIV(const VE_VMS_INSTRUCTION &inst);
+    void op_AND_i8(const VE_VMS_INSTRUCTION &inst);
+    void op_AND_d9(const VE_VMS_INSTRUCTION &inst);
+    void op_AND_R(const VE_VMS_INSTRUCTION &inst);
+    void op_OR_i8(const VE_VMS_INSTRUCTION &inst);
+    void op_OR_d9(const VE_VMS_INSTRUCTION &inst);
+    void op_OR_R(const VE_VMS_INSTRUCTION &inst);
+    void op_XOR_i8(const VE_VMS_INSTRUCTION &inst);
+    void op_XOR_d9(const VE_VMS_INSTRUCTION &inst);
+    void op_XOR_R(const VE_VMS_INSTRUCTION &inst);
+    void op_ROL(const VE_VMS_INSTRUCTION &inst);
+    void op_ROLC(const VE_VMS_INSTRUCTION &inst);
+    void op_ROR(const VE_VMS_INSTRUCTION &inst);
+    void op_RORC(const VE_VMS_INSTRUCTION &inst);
+    void op_LD_d9(const VE_VMS_INSTRUCTION &inst);
+    void op_LD_R(const VE_VMS_INSTRUCTION &inst);
+    void op_ST_d9(const VE_VMS_INSTRUCTION &inst);
+    void op_ST_R(const VE_VMS_INSTRUCTION &inst);
+    void op_MOV_d9(const VE_VMS_INSTRUCTION &inst);
+    void op_MOV_R(const VE_VMS_INSTRUCTION &inst);
+    void op_LDC(const VE_VMS_INSTRUCTION &inst);
+    void op_PUSH(const VE_VMS_INSTRUCTION &inst);
+    void op_POP(const VE_VMS_INSTRUCTION &inst);
+    void op_XCH_d9(const VE_VMS_INSTRUCTION &inst);
+    void op_XCH_R(const VE_VMS_INSTRUCTION &inst);
+    void op_JMP(const VE_VMS_INSTRUCTION &inst);
+    void op_JMPF(const VE_VMS_INSTRUCTION &inst);
+    void op_BR(const VE_VMS_INSTRUCTION &inst);
+    void op_BRF(const VE_VMS_INSTRUCTION &inst);
+    void op_BZ(const VE_VMS_INSTRUCTION &inst);
+    void op_BNZ(const VE_VMS_INSTRUCTION &inst);
+    void op_BP(const VE_VMS_INSTRUCTION &inst);
+    void op_BPC(const VE_VMS_INSTRUCTION &inst);
+    void op_BN(const VE_VMS_INSTRUCTION &inst);
+    void op_DBNZ_d9(const VE_VMS_INSTRUCTION &inst);
+    void op_DBNZ_R(const VE_VMS_INSTRUCTION &inst);
+    void op_BE_i8(const VE_VMS_INSTRUCTION &inst);
+    void op_BE_d9(const VE_VMS_INSTRUCTION &inst);
+    void op_BE_R(const VE_VMS_INSTRUCTION &inst);
+    void op_BNE_i8(const VE_VMS_INSTRUCTION &inst);
+    void op_BNE_d9(const VE_VMS_INSTRUCTION &inst);
+    void op_BNE_R(const VE_VMS_INSTRUCTION &inst);
+    void op_CALL(const VE_VMS_INSTRUCTION &inst);
+    void op_CALLF(const VE_VMS_INSTRUCTION &inst);
+    void op_CALLR(const VE_VMS_INSTRUCTION &inst);
+    void op_RET(const VE_VMS_INSTRUCTION &inst);
+    void op_RETI(const VE_VMS_INSTRUCTION &inst);
+    void op_CLR1(const VE_VMS_INSTRUCTION &inst);
+    void op_SET1(const VE_VMS_INSTRUCTION &inst);
+    void op_NOT1(const VE_VMS_INSTRUCTION &inst);
+    void op_LDF(const VE_VMS_INSTRUCTION &inst);
+    void op_STF(const VE_VMS_INSTRUCTION &inst);
 };
 
 #endif // _CPU_H_
@@ -18,7 +18,7 @@
 
 #include "flash.h"
 
-VE_VMS_FLASH::VE_VMS_FLASH(VE_VMS_RAM *_ram)
+VE_VMS_FLASH::VE_VMS_FLASH(VE_VMS_RAM *_ram, VE_VMS_ICACHE *_icache)
 {
 	userData = new byte[0x19000];
 	directory = new byte[0x1A00];
@@ -30,6 +30,7 @@ VE_VMS_FLASH::VE_VMS_FLASH(VE_VMS_RAM *_ram)
 	IsSaveEnabled = true;
 	
 	ram = _ram;
+	icache = _icache;
 }
 
 VE_VMS_FLASH::~VE_VMS_FLASH()
@@ -164,6 +165,8 @@ void VE_VMS_FLASH::loadROM(byte *d, size_t buffSize, int romType, const char *fi
 	for(size_t j = 0; j < romSize; j++)
 		data[j] = romData[j];
 
+	icache->invalidateAll(ICACHE_FLASH);
+
 	IsSaveEnabled = enableSave;
 
 	if(IsSaveEnabled && romType == 0)
@@ -211,6 +214,13 @@ size_t VE_VMS_FLASH::getData(byte *out)
 }
 
 
+///Returns flash image (Both banks, 0x20000 bytes)
+const byte *VE_VMS_FLASH::getRawData()
+{
+	return data;
+}
+
+
 //Operations
 ///Returns byte at address. (No banking)
 byte VE_VMS_FLASH::getByte(size_t address)
@@ -233,9 +243,7 @@ byte VE_VMS_FLASH::getByte(size_t address)
 ///Returns byte at address (With banking)
 byte VE_VMS_FLASH::readByte(size_t address)
 {
-	if((ram->readByte(0x154) & 1) == 1) address += 0x10000;
-
-	return data[address] & 0xFF;
+	return data[ram->flashBank + address];
 }
 
 //Returns int16 at address (Little-endian)
@@ -281,12 +289,15 @@ void VE_VMS_FLASH::writeByte(size_t address, byte d)
 	else if(address >= 0x1FE00 && address < 0x20000)
 		rootBlock[address - 0x1FE00] = (int)(d & 0xFF);*/
 
-	if((ram->readByte(0x154) & 2) != 0) return;   //An EXT similar register but for Flash
+	if(ram->flashWriteProtected) return;   //FPR, an EXT similar register but for Flash
 
-	if((ram->readByte(0x154) & 1) == 1) address += 0x10000;
+	address += ram->flashBank;
 
 	data[address] = d & 0xFF;
 
+	//Drop predecoded code that overlaps this byte
+	icache->invalidate(ICACHE_FLASH, address);
+
 	//If playing a flashrom, save changes in real time
 	if(IsRealFlash && IsSaveEnabled) 
 	{
@@ -300,6 +311,9 @@ void VE_VMS_FLASH::writeByte_RAW(size_t address, byte d)
 {
 	data[address] = d & 0xFF;
 
+	//Drop predecoded code that overlaps this byte
+	icache->invalidate(ICACHE_FLASH, address);
+
 	//If playing a flashrom, save changes in real time
 	if(IsRealFlash && IsSaveEnabled) 
 	{
@@ -308,6 +322,38 @@ void VE_VMS_FLASH::writeByte_RAW(size_t address, byte d)
 	}
 }
 
+///Copies count bytes starting at raw address (No banking), returns bytes copied
+size_t VE_VMS_FLASH::read(size_t address, byte *out, size_t count)
+{
+	if(address >= 0x20000) return 0;
+	if(count > 0x20000 - address) count = 0x20000 - address;
+
+	memcpy(out, data + address, count);
+
+	return count;
+}
+
+///Writes count bytes starting at raw address (No banking), returns bytes written
+size_t VE_VMS_FLASH::write(size_t address, const byte *in, size_t count)
+{
+	if(address >= 0x20000) return 0;
+	if(count > 0x20000 - address) count = 0x20000 - address;
+
+	memcpy(data + address, in, count);
+
+	//Drop predecoded code that overlaps these bytes
+	icache->invalidateRange(ICACHE_FLASH, address, count);
+
+	//If playing a flashrom, save changes in real time
+	if(IsRealFlash && IsSaveEnabled) 
+	{
+		fseek(flashWriter, address, SEEK_SET);
+		fwrite(in, 1, count, flashWriter);
+	}
+
+	return count;
+}
+
 ///Writes int16 to address (Little-endian)
 void VE_VMS_FLASH::writeWord(size_t address, byte d)
 {
@@ -24,11 +24,12 @@
 #include "common.h"
 #include "flashfile.h"
 #include "ram.h"
+#include "icache.h"
 
 class VE_VMS_FLASH
 {
 public:
-    VE_VMS_FLASH(VE_VMS_RAM *_ram);
+    VE_VMS_FLASH(VE_VMS_RAM *_ram, VE_VMS_ICACHE *_icache);
     ~VE_VMS_FLASH();
 
     ///Loads raw VMS data to be easily accessed.
@@ -43,6 +44,9 @@ public:
     ///Returns data
     size_t getData(byte *out);
 
+    ///Returns flash image (Both banks, 0x20000 bytes)
+    const byte *getRawData();
+
 
     //Operations
     ///Returns byte at address. (No banking)
@@ -60,6 +64,12 @@ public:
     //Writes int to raw address
     void writeByte_RAW(size_t address, byte d);
 
+    ///Copies count bytes starting at raw address (No banking), returns bytes copied
+    size_t read(size_t address, byte *out, size_t count);
+
+    ///Writes count bytes starting at raw address (No banking), returns bytes written
+    size_t write(size_t address, const byte *in, size_t count);
+
     ///Writes int16 to address (Little-endian)
     void writeWord(size_t address, byte d);
 
@@ -102,6 +112,7 @@ private:
     bool IsSaveEnabled;
     
     VE_VMS_RAM *ram;
+    VE_VMS_ICACHE *icache;
 };
 
 #endif // _FLASH_H_
@@ -0,0 +1,94 @@
+/*
+    VeMUlator - A Dreamcast Visual Memory Unit emulator for libretro
+    Copyright (C) 2018  Mahmoud Jaoune
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "icache.h"
+
+VE_VMS_ICACHE::VE_VMS_ICACHE()
+{
+	for(int bank = 0; bank < 2; ++bank)
+		for(size_t i = 0; i < ICACHE_PAGE_COUNT; ++i)
+			pages[bank][i] = NULL;
+
+	generation[ICACHE_ROM] = 0;
+	generation[ICACHE_FLASH] = 0;
+}
+
+VE_VMS_ICACHE::~VE_VMS_ICACHE()
+{
+	for(int bank = 0; bank < 2; ++bank)
+		for(size_t i = 0; i < ICACHE_PAGE_COUNT; ++i)
+			delete []pages[bank][i];
+}
+
+///Allocates a page of entries, none decoded
+VE_VMS_ICACHE_ENTRY *VE_VMS_ICACHE::newPage(byte bank, size_t page)
+{
+	VE_VMS_ICACHE_ENTRY *entries = new VE_VMS_ICACHE_ENTRY[ICACHE_PAGE_SIZE];
+
+	for(size_t i = 0; i < ICACHE_PAGE_SIZE; ++i)
+		entries[i].handler = NULL;
+
+	pages[bank][page] = entries;
+	return entries;
+}
+
+///Drops every instruction that has a byte at address (Call after a code byte is modified)
+void VE_VMS_ICACHE::invalidate(byte bank, size_t address)
+{
+	//Anything above 64KB (Flash bank 1) is never fetched as code
+	if(address >= ICACHE_BANK_SIZE) return;
+
+	//Instructions are at most 3 bytes long, so only the entries starting up to 2 bytes before can overlap
+	for(size_t i = 0; i < 3; ++i)
+	{
+		size_t start = (address - i) & 0xFFFF;
+
+		//Nothing was decoded in a page that was never allocated
+		VE_VMS_ICACHE_ENTRY *page = pages[bank][start / ICACHE_PAGE_SIZE];
+		if(page == NULL) continue;
+
+		VE_VMS_ICACHE_ENTRY &entry = page[start % ICACHE_PAGE_SIZE];
+
+		if(entry.handler != NULL && entry.inst.length > i)
+		{
+			entry.handler = NULL;
+			++generation[bank];
+		}
+	}
+}
+
+///Drops every instruction that has a byte in [address, address + count)
+void VE_VMS_ICACHE::invalidateRange(byte bank, size_t address, size_t count)
+{
+	for(size_t i = 0; i < count; ++i)
+		invalidate(bank, address + i);
+}
+
+///Drops all instructions in bank (Call after a code bank is reloaded)
+void VE_VMS_ICACHE::invalidateAll(byte bank)
+{
+	for(size_t i = 0; i < ICACHE_PAGE_COUNT; ++i)
+	{
+		if(pages[bank][i] == NULL) continue;
+
+		for(size_t j = 0; j < ICACHE_PAGE_SIZE; ++j)
+			pages[bank][i][j].handler = NULL;
+	}
+
+	++generation[bank];
+}
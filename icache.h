@@ -0,0 +1,89 @@
+/*
+    VeMUlator - A Dreamcast Visual Memory Unit emulator for libretro
+    Copyright (C) 2018  Mahmoud Jaoune
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef _ICACHE_H_
+#define _ICACHE_H_
+
+#include "common.h"
+#include "opcodes.h"
+
+class VE_VMS_CPU;
+
+//Instruction handler, called with PC already pointing to the next instruction
+typedef void (VE_VMS_CPU::*VE_VMS_HANDLER)(const VE_VMS_INSTRUCTION &inst);
+
+//Code banks, same value as EXT bit 0
+#define ICACHE_ROM 0
+#define ICACHE_FLASH 1
+
+//Instructions fetched through readByteRF wrap at 64KB, so that is the size of each bank
+#define ICACHE_BANK_SIZE 0x10000
+
+//Tables indexed by code address are split in pages allocated on first use (Software runs a few KB of each bank)
+#define ICACHE_PAGE_SIZE 0x100
+#define ICACHE_PAGE_COUNT (ICACHE_BANK_SIZE / ICACHE_PAGE_SIZE)
+
+//A predecoded instruction (handler is NULL when the entry is not decoded yet)
+struct VE_VMS_ICACHE_ENTRY
+{
+    VE_VMS_HANDLER handler;
+    VE_VMS_INSTRUCTION inst;
+};
+
+class VE_VMS_ICACHE
+{
+public:
+    VE_VMS_ICACHE();
+    ~VE_VMS_ICACHE();
+
+    ///Returns entry of instruction starting at address in bank
+    VE_VMS_ICACHE_ENTRY &getEntry(byte bank, size_t address)
+    {
+        address &= 0xFFFF;
+
+        VE_VMS_ICACHE_ENTRY *page = pages[bank][address / ICACHE_PAGE_SIZE];
+        if(page == NULL) page = newPage(bank, address / ICACHE_PAGE_SIZE);
+
+        return page[address % ICACHE_PAGE_SIZE];
+    }
+
+    ///Drops every instruction that has a byte at address (Call after a code byte is modified)
+    void invalidate(byte bank, size_t address);
+
+    ///Drops every instruction that has a byte in [address, address + count)
+    void invalidateRange(byte bank, size_t address, size_t count);
+
+    ///Drops all instructions in bank (Call after a code bank is reloaded)
+    void invalidateAll(byte bank);
+
+    ///Changes each time a decoded instruction in bank is dropped (Anything built from decoded code checks it)
+    unsigned getGeneration(byte bank)
+    {
+        return generation[bank];
+    }
+
+private:
+    //Pages stay allocated until the cache is deleted (Blocks point to their instructions)
+    VE_VMS_ICACHE_ENTRY *pages[2][ICACHE_PAGE_COUNT];
+    unsigned generation[2];
+
+    //Allocates a page of entries, none decoded
+    VE_VMS_ICACHE_ENTRY *newPage(byte bank, size_t page);
+};
+
+#endif // _ICACHE_H_
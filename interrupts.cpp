@@ -18,19 +18,12 @@
 
 #include "interrupts.h"
 
+//Handler addresses, indexed by source
+static const uint16_t vectors[INT_COUNT] = {0x00, 0x03, 0x0B, 0x13, 0x1B, 0x23, 0x2B, 0x33, 0x3B, 0x43, 0x4B};
+
 VE_VMS_INTERRUPTS::VE_VMS_INTERRUPTS()
 {
-	Reset = 0;
-    INT0 = 0;
-    INT1 = 0;
-    INT2 = 0;
-    INT3 = 0;
-    T0HOV = 0;
-    T1HLOV = 0;
-    SIO0 = 0;
-    SIO1 = 0;
-    RFB = 0;
-    P3_data = 0;
+	pending = 0;
     P3_Taken = true;
 }
 
@@ -40,134 +33,154 @@ VE_VMS_INTERRUPTS::~VE_VMS_INTERRUPTS()
 
 //Setters
 void VE_VMS_INTERRUPTS::setReset(){
-	Reset = 1;
+	pending |= 1 << INT_RESET;
 }
 void VE_VMS_INTERRUPTS::clearReset(){
-	Reset = 0;
+	pending &= ~(1 << INT_RESET);
 }
 
 void VE_VMS_INTERRUPTS::setINT0(){
-	INT0 = 1;
+	pending |= 1 << INT_INT0;
 }
 void VE_VMS_INTERRUPTS::clearINT0(){
-	INT0 = 0;
+	pending &= ~(1 << INT_INT0);
 }
 
 void VE_VMS_INTERRUPTS::setINT1(){
-	INT1 = 1;
+	pending |= 1 << INT_INT1;
 }
 void VE_VMS_INTERRUPTS::clearINT1(){
-	INT1 = 0;
+	pending &= ~(1 << INT_INT1);
 }
 
 void VE_VMS_INTERRUPTS::setINT2(){
-	INT2 = 1;
+	pending |= 1 << INT_INT2;
 }
 void VE_VMS_INTERRUPTS::clearINT2(){
-	INT2 = 0;
+	pending &= ~(1 << INT_INT2);
 }
 
 void VE_VMS_INTERRUPTS::setINT3(){
-	INT3 = 1;
+	pending |= 1 << INT_INT3;
 }
 void VE_VMS_INTERRUPTS::clearINT3(){
-	INT3 = 0;
+	pending &= ~(1 << INT_INT3);
 }
 
 void VE_VMS_INTERRUPTS::setT0HOV(){
-	T0HOV = 1;
+	pending |= 1 << INT_T0HOV;
 }
 void VE_VMS_INTERRUPTS::clearT0HOV(){
-	T0HOV = 0;
+	pending &= ~(1 << INT_T0HOV);
 }
 
 void VE_VMS_INTERRUPTS::setT1HLOV(){
-	T1HLOV = 1;
+	pending |= 1 << INT_T1HLOV;
 }
 void VE_VMS_INTERRUPTS::clearT1HLOV(){
-	T1HLOV = 0;
+	pending &= ~(1 << INT_T1HLOV);
 }
 
 void VE_VMS_INTERRUPTS::setSIO0(){
-	SIO0 = 1;
+	pending |= 1 << INT_SIO0;
 }
 void VE_VMS_INTERRUPTS::clearSIO0(){
-	SIO0 = 0;
+	pending &= ~(1 << INT_SIO0);
 }
 
 void VE_VMS_INTERRUPTS::setSIO1(){
-	SIO1 = 1;
+	pending |= 1 << INT_SIO1;
 }
 void VE_VMS_INTERRUPTS::clearSIO1(){
-	SIO1 = 0;
+	pending &= ~(1 << INT_SIO1);
 }
 
 void VE_VMS_INTERRUPTS::setRFB(){
-	RFB = 1;
+	pending |= 1 << INT_RFB;
 }
 void VE_VMS_INTERRUPTS::clearRFB(){
-	RFB = 0;
+	pending &= ~(1 << INT_RFB);
 }
 
 void VE_VMS_INTERRUPTS::setP3(){
-	P3_data = 1;
+	pending |= 1 << INT_P3;
 }
 void VE_VMS_INTERRUPTS::clearP3(){
-	P3_data = 0;
+	pending &= ~(1 << INT_P3);
+}
+
+void VE_VMS_INTERRUPTS::clear(int source){
+	pending &= ~(1 << source);
 }
 
 //Getters
 byte VE_VMS_INTERRUPTS::getReset()
 {
-	return Reset;
+	return (pending >> INT_RESET) & 1;
 }
 
 byte VE_VMS_INTERRUPTS::getINT0()
 {
-	return  INT0;
+	return (pending >> INT_INT0) & 1;
 }
 
 byte VE_VMS_INTERRUPTS::getINT1()
 {
-	return INT1;
+	return (pending >> INT_INT1) & 1;
 }
 
 byte VE_VMS_INTERRUPTS::getINT2()
 {
-	return INT2;
+	return (pending >> INT_INT2) & 1;
 }
 
 byte VE_VMS_INTERRUPTS::getINT3()
 {
-	return  INT3;
+	return (pending >> INT_INT3) & 1;
 }
 
 byte VE_VMS_INTERRUPTS::getT0HOV()
 {
-	return T0HOV;
+	return (pending >> INT_T0HOV) & 1;
 }
 
 byte VE_VMS_INTERRUPTS::getT1HLOV()
 {
-	return T1HLOV;
+	return (pending >> INT_T1HLOV) & 1;
 }
 
 byte VE_VMS_INTERRUPTS::getSIO0()
 {
-	return  SIO0;
+	return (pending >> INT_SIO0) & 1;
 }
 
 byte VE_VMS_INTERRUPTS::getSIO1()
 {
-	return SIO1;
+	return (pending >> INT_SIO1) & 1;
 }
 
 byte VE_VMS_INTERRUPTS::getRFB()
 {
-	return RFB;
+	return (pending >> INT_RFB) & 1;
 }
 
 byte VE_VMS_INTERRUPTS::getP3()
 {
-	return P3_data;
+	return (pending >> INT_P3) & 1;
+}
+
+///Sources allowed by IE (Bit 7 enables all, otherwise INT0 and INT1 are only blocked by bits 0 and 1)
+uint32_t VE_VMS_INTERRUPTS::getEnabled(byte IE_data)
+{
+	if(IE_data & 128) return INT_ALL;
+	if(IE_data & 1) return 0;
+	if(IE_data & 2) return 1 << INT_INT0;
+
+	return INT_NONMASKABLE;
+}
+
+///Address of interrupt handler of source
+uint16_t VE_VMS_INTERRUPTS::getVector(int source)
+{
+	return vectors[source];
 }
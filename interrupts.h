@@ -21,6 +21,24 @@
 
 #include "common.h"
 
+//Interrupt sources, also bit number in pending mask. Lower number is higher priority.
+#define INT_RESET 0
+#define INT_INT0 1
+#define INT_INT1 2
+#define INT_INT2 3
+#define INT_INT3 4
+#define INT_T0HOV 5
+#define INT_T1HLOV 6
+#define INT_SIO0 7
+#define INT_SIO1 8
+#define INT_RFB 9
+#define INT_P3 10
+#define INT_COUNT 11
+
+//Sources that are not blocked by IE bit 7 (Unless IE bit 0/1 blocks them)
+#define INT_NONMASKABLE ((1 << INT_INT0) | (1 << INT_INT1))
+#define INT_ALL ((1 << INT_COUNT) - 1)
+
 class VE_VMS_INTERRUPTS
 {
 	
@@ -61,6 +79,8 @@ public:
     void setP3();
     void clearP3();
 
+    void clear(int source);
+
     //Getters
     byte getReset();
     byte getINT0();
@@ -74,21 +94,28 @@ public:
     byte getRFB();
     byte getP3();
     
+    ///Returns true if any interrupt is waiting to be taken
+    bool hasPending()
+    {
+        return pending != 0;
+    }
+
+    ///Pending sources (Bit n is source n)
+    uint32_t getPending()
+    {
+        return pending;
+    }
+
+    ///Sources allowed by IE
+    static uint32_t getEnabled(byte IE_data);
+
+    ///Address of interrupt handler of source
+    static uint16_t getVector(int source);
+
     bool P3_Taken;
     
 private:  
-	//Interrupts
-    byte Reset;
-    byte INT0;
-    byte INT1;
-    byte INT2;
-    byte INT3;
-    byte T0HOV;
-    byte T1HLOV;
-    byte SIO0;
-    byte SIO1;
-    byte RFB;
-    byte P3_data;
+    uint32_t pending;
 };
 
 #endif // _INTERRUPTS_H_
@@ -0,0 +1,548 @@
+/*
+    VeMUlator - A Dreamcast Visual Memory Unit emulator for libretro
+    Copyright (C) 2018  Mahmoud Jaoune
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include "jit.h"
+#include "log.h"
+
+#ifdef VE_VMS_JIT_NATIVE
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+//Opcodes translated inline
+#define OP_NOP 0x00
+#define OP_BR 0x01
+#define OP_LD 0x02
+#define OP_ST 0x12
+#define OP_JMPF 0x21
+#define OP_MOV 0x22
+#define OP_INC 0x62
+#define OP_DEC 0x72
+#define OP_BZ 0x80
+#define OP_BNZ 0x90
+
+VE_VMS_JIT::VE_VMS_JIT(VE_VMS_CPU *_cpu, VE_VMS_RAM *_ram, VE_VMS_ICACHE *_icache, bool _verify)
+{
+	cpu = _cpu;
+	ram = _ram;
+	icache = _icache;
+	verify = _verify;
+
+	for(int bank = 0; bank < 2; ++bank)
+		for(size_t i = 0; i < ICACHE_PAGE_COUNT; ++i)
+			pages[bank][i] = NULL;
+
+	code = NULL;
+	codeUsed = 0;
+	pageSize = 0;
+	out = NULL;
+	branched = false;
+
+#ifdef VE_VMS_JIT_NATIVE
+	//Pages are made writable only while a block is emitted into them, then executable (Never both)
+	pageSize = sysconf(_SC_PAGESIZE);
+	void *buffer = mmap(NULL, JIT_CODE_SIZE, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(buffer != MAP_FAILED) code = (byte *)buffer;
+	else LOG_print(LOG_LEVEL_WARN, "JIT: Can't allocate code buffer, using block interpreter");
+#endif
+
+	memset(&stats, 0, sizeof(stats));
+
+	runningBank = 0;
+	pendingAtStart = false;
+
+	flush();
+	stats.flushes = 0;
+}
+
+VE_VMS_JIT::~VE_VMS_JIT()
+{
+#ifdef VE_VMS_JIT_NATIVE
+	if(code != NULL) munmap(code, JIT_CODE_SIZE);
+#endif
+
+	for(int bank = 0; bank < 2; ++bank)
+		for(size_t i = 0; i < ICACHE_PAGE_COUNT; ++i)
+			delete []pages[bank][i];
+}
+
+///Returns translation cache entry of address in bank, its page is allocated on first use
+VE_VMS_JIT_ENTRY &VE_VMS_JIT::getEntry(byte bank, size_t address)
+{
+	VE_VMS_JIT_ENTRY *&page = pages[bank][address / ICACHE_PAGE_SIZE];
+
+	if(page == NULL)
+	{
+		//No code is translated for any generation yet
+		page = new VE_VMS_JIT_ENTRY[ICACHE_PAGE_SIZE];
+
+		for(size_t i = 0; i < ICACHE_PAGE_SIZE; ++i)
+		{
+			page[i].code = NULL;
+			page[i].generation = ~0U;
+			page[i].hits = 0;
+			page[i].failed = false;
+		}
+	}
+
+	return page[address % ICACHE_PAGE_SIZE];
+}
+
+///Drops all translations. Blocks that failed stay interpreted, only a new code generation clears that.
+void VE_VMS_JIT::flush()
+{
+	for(int bank = 0; bank < 2; ++bank)
+	{
+		for(size_t i = 0; i < ICACHE_PAGE_COUNT; ++i)
+		{
+			if(pages[bank][i] == NULL) continue;
+
+			for(size_t j = 0; j < ICACHE_PAGE_SIZE; ++j)
+			{
+				pages[bank][i][j].code = NULL;
+				pages[bank][i][j].hits = 0;
+			}
+		}
+	}
+
+	codeUsed = 0;
+	stats.flushes++;
+}
+
+///Runs one block (Its instructions that start within maxCycles), returns cycles they took
+template<class System>
+int VE_VMS_JIT::run(int maxCycles)
+{
+	if(cpu->state != 1) return 0;  //CPU in halt state
+
+	cpu->checkEXT<System>();
+
+	byte bank = ram->readByte_RAW(EXT) & 0x1;
+	size_t address = cpu->PC;
+
+	VE_VMS_BLOCK *block = cpu->getBlock(bank);
+	VE_VMS_JIT_ENTRY &entry = getEntry(bank, address);
+
+	//Code was modified (Flash write), translation is stale
+	unsigned generation = icache->getGeneration(bank);
+	if(entry.generation != generation)
+	{
+		entry.code = NULL;
+		entry.generation = generation;
+		entry.hits = 0;
+		entry.failed = false;
+	}
+
+	//Translate hot blocks
+	if(entry.code == NULL && !entry.failed && ++entry.hits >= JIT_THRESHOLD)
+	{
+		entry.code = translate(block, address);	//May flush the translation cache
+		entry.generation = generation;
+		if(entry.code == NULL) entry.failed = true;
+	}
+
+	//Native blocks always run to their end (Or an early exit), so their last instruction must start within the budget
+	if(entry.code == NULL || block->cyclesAt[block->instructionCount - 1] >= maxCycles)
+	{
+		stats.interpretedRuns++;
+		return cpu->executeBlock<VE_VMS_TRACE_OFF>(block, bank, maxCycles);
+	}
+
+	runningBank = bank;
+	pendingAtStart = cpu->intHandler->hasPending();
+
+	int executed;
+	if(verify) executed = runVerified<System>(entry, bank, address);
+	else
+	{
+		executed = entry.code();
+		cpu->instructionCount += executed;
+
+		//Whole block ran and branched back, may be spinning (Verified runs found that with the interpreter)
+		if(executed == block->instructionCount && block->loopBranch && cpu->PC <= block->last) cpu->checkBusyLoop(bank, block->last);
+	}
+
+	stats.nativeRuns++;
+	stats.nativeInstructions += executed;
+
+	return block->cyclesAt[executed];
+}
+
+//Runs native block, then repeats it with processInstruction and compares
+template<class System>
+int VE_VMS_JIT::runVerified(VE_VMS_JIT_ENTRY &entry, byte bank, size_t address)
+{
+	byte before[RAM_STATE_SIZE];
+	byte native[RAM_STATE_SIZE];
+	byte reference[RAM_STATE_SIZE];
+
+	//Snapshot
+	ram->saveState(before);
+	int state = cpu->state;
+	int interruptLevel = cpu->interruptLevel;
+	int currentInterrupt = cpu->currentInterrupt;
+	int interruptStack[INTERRUPT_STACK_DEPTH];
+	memcpy(interruptStack, cpu->interruptStack, sizeof(interruptStack));
+	bool P3_taken = cpu->P3_taken;
+
+	int executed = entry.code();
+
+	ram->saveState(native);
+	size_t nativePC = cpu->PC;
+	int nativeState = cpu->state;
+
+	//Rewind and run reference
+	ram->loadState(before);
+	cpu->PC = address;
+	cpu->state = state;
+	cpu->interruptLevel = interruptLevel;
+	cpu->currentInterrupt = currentInterrupt;
+	memcpy(cpu->interruptStack, interruptStack, sizeof(interruptStack));
+	cpu->P3_taken = P3_taken;
+
+	for(int i = 0; i < executed; ++i)
+		cpu->processInstruction<System, VE_VMS_TRACE_OFF>();
+
+	ram->saveState(reference);
+
+	//Reference result is kept either way
+	if(nativePC != cpu->PC || nativeState != cpu->state || memcmp(native, reference, RAM_STATE_SIZE) != 0)
+	{
+		LOG_print(LOG_LEVEL_WARN, "JIT: Mismatch in block %d:%04X (PC %04X, expected %04X), interpreting it from now on", bank, (unsigned)address, (unsigned)nativePC, (unsigned)cpu->PC);
+
+		entry.code = NULL;
+		entry.failed = true;
+		stats.mismatches++;
+	}
+
+	return executed;
+}
+
+template int VE_VMS_JIT::run<VE_VMS_HLE>(int maxCycles);
+template int VE_VMS_JIT::run<VE_VMS_BIOS>(int maxCycles);
+
+//Called from native code for anything not translated inline, returns nonzero if block must stop
+int VE_VMS_JIT::callOp(VE_VMS_JIT *jit, const VE_VMS_BLOCK_OP *op)
+{
+	VE_VMS_CPU *cpu = jit->cpu;
+
+	cpu->PC = (cpu->PC + op->length) & 0xFFFF;
+
+	if(op->fused != NULL) (cpu->*op->fused)(*op->first, *op->second);
+	else (cpu->*op->handler)(*op->first);
+
+	//Same early exits as the block interpreter
+	VE_VMS_RAM *ram = jit->ram;
+	if(ram->readByte_RAW(PCON) != 0 || (ram->readByte_RAW(EXT) & 0x1) != jit->runningBank) return 1;
+	if(!jit->pendingAtStart && cpu->intHandler->hasPending()) return 1;
+
+	return 0;
+}
+
+///Logs translation statistics at debug level
+void VE_VMS_JIT::logStats()
+{
+	LOG_print(LOG_LEVEL_DEBUG, "JIT: %lu blocks translated, %lu flushes", stats.translated, stats.flushes);
+	LOG_print(LOG_LEVEL_DEBUG, "JIT: %lu native runs (%lu instructions), %lu interpreted runs", stats.nativeRuns, stats.nativeInstructions, stats.interpretedRuns);
+	if(verify) LOG_print(LOG_LEVEL_DEBUG, "JIT: %lu verification mismatches", stats.mismatches);
+}
+
+
+/******************************************************
+ ******************************************************
+ *  x86-64 code generation
+ *
+ *  rbx: this, r14: RAM data, r15: &PC
+ ******************************************************
+ ******************************************************/
+
+///Code buffer pages are either writable or executable, translate() switches pages of the block it emits
+bool VE_VMS_JIT::protect(byte *start, size_t size, bool writable)
+{
+#ifdef VE_VMS_JIT_NATIVE
+	size_t first = (size_t)(start - code) & ~(pageSize - 1);
+	size_t last = ((size_t)(start - code) + size + pageSize - 1) & ~(pageSize - 1);
+	if(last > JIT_CODE_SIZE) last = JIT_CODE_SIZE;
+
+	return mprotect(code + first, last - first, writable ? (PROT_READ | PROT_WRITE) : (PROT_READ | PROT_EXEC)) == 0;
+#else
+	return false;
+#endif
+}
+
+void VE_VMS_JIT::emit8(byte b)
+{
+	*out++ = b;
+}
+
+void VE_VMS_JIT::emit32(uint32_t v)
+{
+	for(int i = 0; i < 4; ++i, v >>= 8)
+		emit8(v & 0xFF);
+}
+
+void VE_VMS_JIT::emit64(uint64_t v)
+{
+	for(int i = 0; i < 8; ++i, v >>= 8)
+		emit8(v & 0xFF);
+}
+
+//mov qword [r15], address
+void VE_VMS_JIT::emitSetPC(size_t address)
+{
+	emit8(0x49); emit8(0xC7); emit8(0x07); emit32(address);
+}
+
+//Sets PC to target of a translated branch (Always last op of a block)
+void VE_VMS_JIT::emitBranch(size_t target)
+{
+	emitSetPC(target);
+	branched = true;
+}
+
+//Main RAM and plain SFR are read straight from RAM data, everything with side effects or banking (XRAM) goes through VE_VMS_RAM
+bool VE_VMS_JIT::canRead(uint16_t d9)
+{
+	if(d9 >= 0x180 || VE_VMS_RAM::isTimerSFR(d9)) return false;
+	//PSW may have pending ALU flags
+	return d9 != VTRBF && d9 != PSW;
+}
+
+bool VE_VMS_JIT::canWrite(uint16_t d9)
+{
+	//Writes with side effects (Timers, banks, latches, observers) go through VE_VMS_RAM
+	if(d9 >= 0x180 || !ram->isPlainWrite(d9)) return false;
+	//PCON writes end a block, so they must be checked
+	return d9 != PCON;
+}
+
+//Emits "opcode reg, byte [d9]" on RAM data, main RAM is banked by PSW bit 1 (Second bank is 512 bytes in)
+void VE_VMS_JIT::emitMem(byte opcode, byte reg, uint16_t d9)
+{
+	if(d9 < 0x100)
+	{
+		//movzx ecx, byte [r14 + PSW]; and ecx, 2; shl ecx, 8
+		emit8(0x41); emit8(0x0F); emit8(0xB6); emit8(0x8E); emit32(PSW);
+		emit8(0x83); emit8(0xE1); emit8(0x02);
+		emit8(0xC1); emit8(0xE1); emit8(0x08);
+
+		//[r14 + rcx + d9]
+		emit8(0x41); emit8(opcode); emit8(0x84 | (reg << 3)); emit8(0x0E); emit32(d9);
+	}
+	else
+	{
+		//[r14 + d9]
+		emit8(0x41); emit8(opcode); emit8(0x86 | (reg << 3)); emit32(d9);
+	}
+}
+
+//Translates op without calling back into the CPU if possible, PC is only written by branches
+bool VE_VMS_JIT::emitInline(const VE_VMS_BLOCK_OP &op, size_t address, size_t next)
+{
+	const VE_VMS_INSTRUCTION &inst = *op.first;
+	byte opcode = inst.opcode;
+
+	if(op.fused != NULL)
+	{
+		const VE_VMS_INSTRUCTION &inst2 = *op.second;
+
+		//Only LD pairs are translated, other fused ops are called
+		if((opcode & 0xFE) != OP_LD) return false;
+
+		//LD d9, ST d9
+		if((inst2.opcode & 0xFE) == OP_ST && canRead(inst.d9) && canWrite(inst2.d9))
+		{
+			emitMem(0x8A, 0, inst.d9);		//mov al, [d9]
+			emitMem(0x88, 0, ACC);			//mov [ACC], al
+			emitMem(0x88, 0, inst2.d9);		//mov [d9], al
+			return true;
+		}
+
+		//LD d9, BZ/BNZ r8
+		if((inst2.opcode == OP_BZ || inst2.opcode == OP_BNZ) && canRead(inst.d9))
+		{
+			emitMem(0x8A, 0, inst.d9);
+			emitMem(0x88, 0, ACC);
+
+			emitSetPC(next);
+			emit8(0x84); emit8(0xC0);								//test al, al
+			emit8(inst2.opcode == OP_BZ ? 0x75 : 0x74); emit8(7);	//jnz/jz over
+			emitBranch((next + inst2.r8) & 0xFFFF);
+			return true;
+		}
+
+		return false;
+	}
+
+	switch(opcode)
+	{
+		case OP_NOP:
+			return true;
+
+		case OP_LD:
+		case OP_LD + 1:
+			if(!canRead(inst.d9)) return false;
+			emitMem(0x8A, 0, inst.d9);
+			emitMem(0x88, 0, ACC);
+			return true;
+
+		case OP_ST:
+		case OP_ST + 1:
+			if(!canWrite(inst.d9)) return false;
+			emitMem(0x8A, 0, ACC);
+			emitMem(0x88, 0, inst.d9);
+			return true;
+
+		case OP_MOV:
+		case OP_MOV + 1:
+			if(!canWrite(inst.d9)) return false;
+			emitMem(0xC6, 0, inst.d9); emit8(inst.i8);		//mov byte [d9], i8
+			return true;
+
+		case OP_INC:
+		case OP_INC + 1:
+		case OP_DEC:
+		case OP_DEC + 1:
+			if(!canRead(inst.d9) || !canWrite(inst.d9)) return false;
+			emitMem(0xFE, (opcode & 0xFE) == OP_INC ? 0 : 1, inst.d9);	//inc/dec byte [d9]
+			return true;
+
+		case OP_BR:
+			emitBranch((next + inst.r8) & 0xFFFF);
+			return true;
+
+		case OP_JMPF:
+			emitBranch(inst.a16);
+			return true;
+
+		case OP_BZ:
+		case OP_BNZ:
+			emitSetPC(next);
+			emitMem(0x80, 7, ACC); emit8(0);						//cmp byte [ACC], 0
+			emit8(opcode == OP_BZ ? 0x75 : 0x74); emit8(7);
+			emitBranch((next + inst.r8) & 0xFFFF);
+			return true;
+	}
+
+	//JMP a12 (CALL a12 has bit 5 clear)
+	if(opcodeTable[opcode].mode == MODE_A12 && (opcode & 0x20) != 0)
+	{
+		emitBranch(inst.a16 | (next & 0xF000));
+		return true;
+	}
+
+	return false;
+}
+
+//Translates block starting at address
+VE_VMS_NATIVE_BLOCK VE_VMS_JIT::translate(VE_VMS_BLOCK *block, size_t address)
+{
+#ifdef VE_VMS_JIT_NATIVE
+	if(code == NULL) return NULL;
+
+	if(codeUsed + JIT_BLOCK_MAX_CODE > JIT_CODE_SIZE) flush();
+
+	byte *start = code + codeUsed;
+	if(!protect(start, JIT_BLOCK_MAX_CODE, true)) return NULL;
+
+	out = start;
+	exits.clear();
+
+	//push rbx, r12, r13, r14, r15 (Keeps stack 16-byte aligned for calls)
+	emit8(0x53);
+	emit8(0x41); emit8(0x54);
+	emit8(0x41); emit8(0x55);
+	emit8(0x41); emit8(0x56);
+	emit8(0x41); emit8(0x57);
+
+	//mov rbx, this; mov r14, RAM data; mov r15, &PC
+	emit8(0x48); emit8(0xBB); emit64((uint64_t)(size_t)this);
+	emit8(0x49); emit8(0xBE); emit64((uint64_t)(size_t)ram->getData());
+	emit8(0x49); emit8(0xBF); emit64((uint64_t)(size_t)&cpu->PC);
+
+	bool PCValid = true;	//PC holds address of current op
+	int executed = 0;
+
+	for(int i = 0; i < block->opCount; ++i)
+	{
+		const VE_VMS_BLOCK_OP &op = block->ops[i];
+		size_t next = (address + op.length) & 0xFFFF;
+
+		executed += op.count;
+
+		branched = false;
+
+		if(emitInline(op, address, next)) PCValid = branched;
+		else
+		{
+			if(!PCValid) emitSetPC(address);
+
+			//callOp(this, op)
+			emit8(0x48); emit8(0x89); emit8(0xDF);
+			emit8(0x48); emit8(0xBE); emit64((uint64_t)(size_t)&op);
+			emit8(0x48); emit8(0xB8); emit64((uint64_t)(size_t)&VE_VMS_JIT::callOp);
+			emit8(0xFF); emit8(0xD0);
+
+			if(i + 1 < block->opCount)
+			{
+				//test eax, eax; jz continue; mov eax, executed; jmp exit
+				emit8(0x85); emit8(0xC0);
+				emit8(0x74); emit8(10);
+				emit8(0xB8); emit32(executed);
+				emit8(0xE9); exits.push_back(out); emit32(0);
+			}
+
+			PCValid = true;
+		}
+
+		address = next;
+	}
+
+	if(!PCValid) emitSetPC(address);
+
+	emit8(0xB8); emit32(executed);
+
+	//Exit: pop r15, r14, r13, r12, rbx; ret
+	byte *exit = out;
+	emit8(0x41); emit8(0x5F);
+	emit8(0x41); emit8(0x5E);
+	emit8(0x41); emit8(0x5D);
+	emit8(0x41); emit8(0x5C);
+	emit8(0x5B);
+	emit8(0xC3);
+
+	for(size_t i = 0; i < exits.size(); ++i)
+	{
+		uint32_t rel = (uint32_t)(exit - (exits[i] + 4));
+		memcpy(exits[i], &rel, 4);
+	}
+
+	codeUsed += out - start;
+	if(!protect(start, JIT_BLOCK_MAX_CODE, false)) return NULL;
+
+	stats.translated++;
+
+	//Object to function pointer conversion
+	VE_VMS_NATIVE_BLOCK f;
+	memcpy(&f, &start, sizeof(f));
+	return f;
+#else
+	return NULL;
+#endif
+}
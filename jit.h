@@ -0,0 +1,126 @@
+/*
+    VeMUlator - A Dreamcast Visual Memory Unit emulator for libretro
+    Copyright (C) 2018  Mahmoud Jaoune
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef _JIT_H_
+#define _JIT_H_
+
+#include <vector>
+#include "common.h"
+#include "ram.h"
+#include "icache.h"
+#include "block.h"
+#include "cpu.h"
+
+//Native code is generated for x86-64 (System V ABI) only, elsewhere every block goes to the block interpreter
+#if defined(__x86_64__) && !defined(_WIN32)
+#define VE_VMS_JIT_NATIVE
+#endif
+
+#define JIT_CODE_SIZE 0x400000      //Translation cache size (4MB)
+#define JIT_BLOCK_MAX_CODE 0x1000   //Worst case native code of one block
+#define JIT_THRESHOLD 8             //Runs of a block before it is translated
+
+//A translated block, returns number of instructions executed
+typedef int (*VE_VMS_NATIVE_BLOCK)();
+
+//Translation cache entry, keyed by (EXT bank, PC)
+struct VE_VMS_JIT_ENTRY
+{
+    VE_VMS_NATIVE_BLOCK code;       //NULL when not translated
+    unsigned generation;            //Instruction cache generation of code
+    unsigned short hits;
+    bool failed;                    //Block stays interpreted (Failed verification)
+};
+
+struct VE_VMS_JIT_STATS
+{
+    unsigned long translated;       //Blocks translated
+    unsigned long nativeRuns;       //Blocks run as native code
+    unsigned long nativeInstructions;
+    unsigned long interpretedRuns;  //Blocks run by the block interpreter (Cold, or not enough budget)
+    unsigned long mismatches;       //Blocks that failed verification
+    unsigned long flushes;          //Translation cache flushes
+};
+
+class VE_VMS_JIT
+{
+public:
+    ///verify: Run each native block in lockstep with processInstruction and compare results
+    VE_VMS_JIT(VE_VMS_CPU *_cpu, VE_VMS_RAM *_ram, VE_VMS_ICACHE *_icache, bool _verify);
+    ~VE_VMS_JIT();
+
+    ///Runs one block (Its instructions that start within maxCycles), returns cycles they took
+    template<class System> int run(int maxCycles);
+
+    ///Logs translation statistics at debug level
+    void logStats();
+
+    VE_VMS_JIT_STATS stats;
+
+private:
+    VE_VMS_CPU *cpu;
+    VE_VMS_RAM *ram;
+    VE_VMS_ICACHE *icache;
+    bool verify;
+
+    //Translation cache, pages are allocated on first use
+    VE_VMS_JIT_ENTRY *pages[2][ICACHE_PAGE_COUNT];
+
+    VE_VMS_JIT_ENTRY &getEntry(byte bank, size_t address);
+
+    //Code buffer
+    byte *code;
+    size_t codeUsed;
+    size_t pageSize;
+
+    //Makes pages holding size bytes at start writable (Not executable) or executable (Not writable)
+    bool protect(byte *start, size_t size, bool writable);
+
+    //Running block (Used by callOp)
+    byte runningBank;
+    bool pendingAtStart;
+
+    //Drops all translations, blocks that failed stay interpreted
+    void flush();
+
+    //Translates block starting at address
+    VE_VMS_NATIVE_BLOCK translate(VE_VMS_BLOCK *block, size_t address);
+
+    //Runs native block, then repeats it with processInstruction and compares
+    template<class System> int runVerified(VE_VMS_JIT_ENTRY &entry, byte bank, size_t address);
+
+    //Called from native code for anything not translated inline, returns nonzero if block must stop
+    static int callOp(VE_VMS_JIT *jit, const VE_VMS_BLOCK_OP *op);
+
+    //x86-64 emitter
+    byte *out;
+    std::vector<byte *> exits;
+    bool branched;      //Last inline op wrote PC
+
+    void emit8(byte b);
+    void emit32(uint32_t v);
+    void emit64(uint64_t v);
+    void emitSetPC(size_t address);
+    void emitBranch(size_t target);
+    bool canRead(uint16_t d9);
+    bool canWrite(uint16_t d9);
+    void emitMem(byte opcode, byte reg, uint16_t d9);
+    bool emitInline(const VE_VMS_BLOCK_OP &op, size_t address, size_t next);
+};
+
+#endif // _JIT_H_
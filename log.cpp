@@ -0,0 +1,42 @@
+/*
+    VeMUlator - A Dreamcast Visual Memory Unit emulator for libretro
+    Copyright (C) 2018  Mahmoud Jaoune
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <stdarg.h>
+#include "log.h"
+
+static LOG_SINK LOG_sink = NULL;
+
+void LOG_setSink(LOG_SINK sink)
+{
+	LOG_sink = sink;
+}
+
+void LOG_print(int level, const char *format, ...)
+{
+	if(LOG_sink == NULL) return;
+
+	char message[LOG_MAX_LENGTH];
+
+	va_list args;
+	va_start(args, format);
+	vsnprintf(message, sizeof(message), format, args);
+	va_end(args);
+
+	LOG_sink(level, message);
+}
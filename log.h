@@ -0,0 +1,43 @@
+/*
+    VeMUlator - A Dreamcast Visual Memory Unit emulator for libretro
+    Copyright (C) 2018  Mahmoud Jaoune
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef _LOG_H_
+#define _LOG_H_
+
+#include "common.h"
+
+//Message levels (Same values as retro_log_level)
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+
+//Longest message, longer ones are cut
+#define LOG_MAX_LENGTH 256
+
+//Receives formatted messages, frontend's log in libretro builds
+typedef void (*LOG_SINK)(int level, const char *message);
+
+///Sets where messages go, NULL drops them (The default, core never writes to stdout)
+void LOG_setSink(LOG_SINK sink);
+
+///Formats a line (printf style, no newline) and passes it to the sink
+void LOG_print(int level, const char *format, ...);
+
+#endif // _LOG_H_
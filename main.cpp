@@ -18,6 +18,7 @@
 
 #include "libretro.h"
 #include "vmu.h"
+#include "log.h"
 
 retro_environment_t environment_cb;
 retro_video_refresh_t video_cb;
@@ -26,11 +27,21 @@ retro_audio_sample_batch_t audio_batch_cb;
 retro_input_poll_t inputPoll_cb;
 retro_input_state_t inputState_cb;
 
-struct retro_variable options[2];
+struct retro_variable options[9];
 
 VMU *vmu;
-uint16_t *frameBuffer;
+byte *frameBuffer;	//Sized for pixel format and scale picked when game is loaded
 byte *romData;
+bool canDupe;	//Frontend repeats last frame when video_cb gets NULL
+bool frameBufferCurrent;	//frameBuffer holds last frame drawn (Not drawn into frontend's framebuffer)
+bool logStats;	//CPU statistics are logged when game is unloaded
+retro_log_printf_t log_cb;
+
+//Core messages go to frontend's log
+static void logToFrontend(int level, const char *message)
+{
+	log_cb((enum retro_log_level)level, "%s\n", message);
+}
 
 
 RETRO_API void retro_set_environment(retro_environment_t env)
@@ -41,10 +52,37 @@ RETRO_API void retro_set_environment(retro_environment_t env)
 	options[0].key = "enable_flash_write"; 
 	options[0].value = "Enable flash write (.bin, requires restart); enabled|disabled";
 	
-	options[1].key = NULL;
-	options[1].value = NULL;
+	options[1].key = "cpu_engine";
+	options[1].value = "CPU engine (requires restart); interpreter|superblock|jit|jit_verify";
+	
+	options[2].key = "cpu_trace";
+	options[2].value = "Trace CPU instructions to log (debug level, interpreter and superblock engines, requires restart); disabled|enabled";
+	
+	options[3].key = "video_scale";
+	options[3].value = "Video scale (requires restart); 1|2|3|4|5|6|7|8|9|10";
+	
+	options[4].key = "video_lcd_effect";
+	options[4].value = "LCD effect (scale 2 and up, requires restart); none|grid|dot matrix";
+	
+	options[5].key = "video_palette";
+	options[5].value = "LCD palette (requires restart); black on white|green|amber|blue";
+	
+	options[6].key = "video_threads";
+	options[6].value = "Video threads (scale 4 and up, requires restart); 1|2|3|4";
+	
+	options[7].key = "cpu_stats";
+	options[7].value = "Log CPU statistics when game is unloaded (debug level); disabled|enabled";
+	
+	options[8].key = NULL;
+	options[8].value = NULL;
 	
 	env(RETRO_ENVIRONMENT_SET_VARIABLES, options);
+	
+	//Log (Messages are dropped when frontend has none)
+	struct retro_log_callback logging;
+	log_cb = NULL;
+	if(env(RETRO_ENVIRONMENT_GET_LOG_INTERFACE, &logging) && logging.log != NULL) log_cb = logging.log;
+	LOG_setSink(log_cb != NULL ? logToFrontend : NULL);
 }
 
 RETRO_API void retro_set_video_refresh(retro_video_refresh_t vr)
@@ -74,8 +112,8 @@ RETRO_API void retro_set_input_state(retro_input_state_t istate)
 
 RETRO_API void retro_init(void)
 {
-	frameBuffer = (uint16_t*)calloc(SCREEN_WIDTH*SCREEN_HEIGHT, sizeof(uint16_t));
-	vmu = new VMU(frameBuffer);
+	frameBuffer = NULL;
+	vmu = new VMU();
 }
 
 RETRO_API void retro_deinit(void)
@@ -101,10 +139,11 @@ RETRO_API void retro_get_system_info(struct retro_system_info *info)
 
 RETRO_API void retro_get_system_av_info(struct retro_system_av_info *info)
 {
-	info->geometry.base_width = SCREEN_WIDTH;
-	info->geometry.base_height = SCREEN_HEIGHT;
-	info->geometry.max_width = SCREEN_WIDTH;
-	info->geometry.max_height = SCREEN_HEIGHT;
+	//Frames are scaled by the core
+	info->geometry.base_width = vmu->video->getWidth();
+	info->geometry.base_height = vmu->video->getHeight();
+	info->geometry.max_width = vmu->video->getWidth();
+	info->geometry.max_height = vmu->video->getHeight();
 	info->geometry.aspect_ratio = 0;
 	
 	info->timing.fps = FPS;
@@ -203,19 +242,68 @@ RETRO_API void retro_reset(void)
 	vmu->reset();
 }
 
+//Value of a core option, NULL if frontend has none
+static const char *getVariable(const char *key)
+{
+	struct retro_variable var = {0};
+	var.key = key;
+
+	if(!environment_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var)) return NULL;
+
+	return var.value;
+}
+
+///LCD is expanded again only when software changed it, frontend may repeat last frame itself.
+///Frame is drawn straight into frontend's framebuffer when it has one in our pixel format, otherwise into ours.
+static void outputVideo()
+{
+	bool changed = vmu->video->hasChanged();
+	unsigned width = vmu->video->getWidth();
+	unsigned height = vmu->video->getHeight();
+	size_t pitch = width * vmu->video->getPixelSize();
+
+	if(!changed && canDupe)
+	{
+		video_cb(NULL, width, height, pitch);
+		return;
+	}
+
+	struct retro_framebuffer fb = {0};
+	fb.width = width;
+	fb.height = height;
+	fb.access_flags = RETRO_MEMORY_ACCESS_WRITE;
+
+	if(environment_cb(RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER, &fb) && fb.data != NULL &&
+		(int)fb.format == vmu->video->getPixelFormat() && fb.pitch >= pitch && (fb.pitch % vmu->video->getPixelSize()) == 0)
+	{
+		//Contents of frontend's memory are unknown, so it is always drawn
+		vmu->video->drawFrame(fb.data, fb.pitch);
+		frameBufferCurrent = false;
+
+		video_cb(fb.data, width, height, fb.pitch);
+		return;
+	}
+
+	if(changed || !frameBufferCurrent)
+	{
+		vmu->video->drawFrame(frameBuffer, pitch);
+		frameBufferCurrent = true;
+	}
+
+	video_cb(frameBuffer, width, height, pitch);
+}
+
 RETRO_API void retro_run(void)
 {
 	processInput();
 	
-	//Cycles passed since last screen refresh
-	size_t cyclesPassed = vmu->cpu->getCurrentFrequency() / FPS;
+	//Cycles passed since last screen refresh (Fraction of a cycle is run next frame)
+	int cyclesPassed = vmu->clock->frameCycles();
 	
-	for(size_t i = 0; i < cyclesPassed; i++)
-		vmu->runCycle();
+	vmu->run(cyclesPassed);
 
 	//Video
-	vmu->video->drawFrame(frameBuffer);
-	if(vmu->ram->readByte_RAW(MCR) & 8) video_cb(frameBuffer, SCREEN_WIDTH, SCREEN_HEIGHT, SCREEN_WIDTH * 2);
+	if(vmu->ram->readByte_RAW(MCR) & 8) outputVideo();
 	
 	//Audio
 	vmu->audio->generateSignal(audio_cb);
@@ -245,8 +333,48 @@ RETRO_API void retro_cheat_set(unsigned index, bool enabled, const char *code)
 RETRO_API bool retro_load_game(const struct retro_game_info *game)
 {
 	//Set environment variables
-	enum retro_pixel_format format = RETRO_PIXEL_FORMAT_RGB565;
-	environment_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &format);
+	//Pixel format, first one frontend accepts (XRGB8888 needs no conversion on most hosts, 0RGB1555 is libretro's default)
+	static const enum retro_pixel_format formats[] = {RETRO_PIXEL_FORMAT_XRGB8888, RETRO_PIXEL_FORMAT_RGB565, RETRO_PIXEL_FORMAT_0RGB1555};
+	VE_VMS_VIDEO_OPTIONS videoOptions;
+	videoOptions.format = VIDEO_FORMAT_0RGB1555;
+	for(int i = 0; i < 3; ++i)
+	{
+		enum retro_pixel_format format = formats[i];
+		if(environment_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &format))
+		{
+			videoOptions.format = format;
+			break;
+		}
+	}
+
+	//Scale, LCD effect and palette (Frontend gets the geometry from retro_get_system_av_info)
+	const char *value = getVariable("video_scale");
+	videoOptions.scale = (value != NULL) ? atoi(value) : 1;
+
+	value = getVariable("video_lcd_effect");
+	videoOptions.effect = VIDEO_EFFECT_NONE;
+	if(value != NULL && !strcmp(value, "grid")) videoOptions.effect = VIDEO_EFFECT_GRID;
+	else if(value != NULL && !strcmp(value, "dot matrix")) videoOptions.effect = VIDEO_EFFECT_DOTS;
+
+	value = getVariable("video_palette");
+	videoOptions.palette = VIDEO_PALETTE_WHITE;
+	if(value != NULL && !strcmp(value, "green")) videoOptions.palette = VIDEO_PALETTE_GREEN;
+	else if(value != NULL && !strcmp(value, "amber")) videoOptions.palette = VIDEO_PALETTE_AMBER;
+	else if(value != NULL && !strcmp(value, "blue")) videoOptions.palette = VIDEO_PALETTE_BLUE;
+
+	value = getVariable("video_threads");
+	videoOptions.threads = (value != NULL) ? atoi(value) : 1;
+
+	vmu->video->setOptions(videoOptions);
+
+	//Frames are drawn here when frontend has no framebuffer of its own
+	free(frameBuffer);
+	frameBuffer = (byte*)calloc(vmu->video->getWidth() * vmu->video->getHeight(), vmu->video->getPixelSize());
+	if(frameBuffer == NULL) return false;
+
+	canDupe = false;
+	if(!environment_cb(RETRO_ENVIRONMENT_GET_CAN_DUPE, &canDupe)) canDupe = false;
+	frameBufferCurrent = false;
 	
 	//Opening file
 	FILE *rom = fopen(game->path, "rb");
@@ -266,16 +394,12 @@ RETRO_API bool retro_load_game(const struct retro_game_info *game)
 	strcpy(path, game->path);
 	char *ext = strchr(path, '.');
 	
-	//Check needed variables
-	struct retro_variable var = {0};
-	var.key = "enable_flash_write";
-	environment_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var);
-	
 	//Loading ROM
 	if(!strcmp(ext, ".bin") || !strcmp(ext, ".BIN")) 
 	{
 		//Check if user wants core to be able to write to flash
-		if(!strcmp(var.value, "enabled")) vmu->flash->loadROM(romData, romSize, 0, game->path, true);
+		value = getVariable("enable_flash_write");
+		if(value != NULL && !strcmp(value, "enabled")) vmu->flash->loadROM(romData, romSize, 0, game->path, true);
 		else vmu->flash->loadROM(romData, romSize, 0, game->path, false);
 	}
 	else if(!strcmp(ext, ".vms") || !strcmp(ext, ".VMS")) vmu->flash->loadROM(romData, romSize, 1, game->path, false);
@@ -283,7 +407,26 @@ RETRO_API bool retro_load_game(const struct retro_game_info *game)
 	
 	free(path);
 	
-	//Initializing system
+	//CPU engine
+	value = getVariable("cpu_engine");
+	int engine = VMU_ENGINE_INTERPRETER;
+	if(value != NULL)
+	{
+		if(!strcmp(value, "superblock")) engine = VMU_ENGINE_SUPERBLOCK;
+		else if(!strcmp(value, "jit")) engine = VMU_ENGINE_JIT;
+		else if(!strcmp(value, "jit_verify")) engine = VMU_ENGINE_JIT_VERIFY;
+	}
+	
+	//Instruction trace
+	value = getVariable("cpu_trace");
+	bool trace = value != NULL && !strcmp(value, "enabled");
+	
+	//Engine statistics
+	value = getVariable("cpu_stats");
+	logStats = value != NULL && !strcmp(value, "enabled");
+	vmu->setEngine(engine, trace);
+	
+	//Initializing system (Picks run loop for engine, trace and HLE or BIOS)
 	vmu->startCPU();
 	
 	return true;
@@ -296,6 +439,8 @@ RETRO_API bool retro_load_game_special(unsigned game_type, const struct retro_ga
 
 RETRO_API void retro_unload_game(void)
 {
+	if(logStats) vmu->logEngineStats();
+	
 	vmu->reset();
 }
 
@@ -0,0 +1,342 @@
+/*
+    VeMUlator - A Dreamcast Visual Memory Unit emulator for libretro
+    Copyright (C) 2018  Mahmoud Jaoune
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "opcodes.h"
+
+//Opcode descriptors, indexed by opcode
+const VE_VMS_OPCODE opcodeTable[256] =
+{
+	{"NOP",   MODE_NONE, 1, 1},                //0x00
+	{"BR",    MODE_R8, 2, 2},                  //0x01
+	{"LD",    MODE_D9, 2, 1},                  //0x02
+	{"LD",    MODE_D9, 2, 1},                  //0x03
+	{"LD",    MODE_R, 1, 1},                   //0x04
+	{"LD",    MODE_R, 1, 1},                   //0x05
+	{"LD",    MODE_R, 1, 1},                   //0x06
+	{"LD",    MODE_R, 1, 1},                   //0x07
+	{"CALL",  MODE_A12, 2, 2},                 //0x08
+	{"CALL",  MODE_A12, 2, 2},                 //0x09
+	{"CALL",  MODE_A12, 2, 2},                 //0x0A
+	{"CALL",  MODE_A12, 2, 2},                 //0x0B
+	{"CALL",  MODE_A12, 2, 2},                 //0x0C
+	{"CALL",  MODE_A12, 2, 2},                 //0x0D
+	{"CALL",  MODE_A12, 2, 2},                 //0x0E
+	{"CALL",  MODE_A12, 2, 2},                 //0x0F
+	{"CALLR", MODE_R16, 3, 4},                 //0x10
+	{"BRF",   MODE_R16, 3, 4},                 //0x11
+	{"ST",    MODE_D9, 2, 1},                  //0x12
+	{"ST",    MODE_D9, 2, 1},                  //0x13
+	{"ST",    MODE_R, 1, 1},                   //0x14
+	{"ST",    MODE_R, 1, 1},                   //0x15
+	{"ST",    MODE_R, 1, 1},                   //0x16
+	{"ST",    MODE_R, 1, 1},                   //0x17
+	{"CALL",  MODE_A12, 2, 2},                 //0x18
+	{"CALL",  MODE_A12, 2, 2},                 //0x19
+	{"CALL",  MODE_A12, 2, 2},                 //0x1A
+	{"CALL",  MODE_A12, 2, 2},                 //0x1B
+	{"CALL",  MODE_A12, 2, 2},                 //0x1C
+	{"CALL",  MODE_A12, 2, 2},                 //0x1D
+	{"CALL",  MODE_A12, 2, 2},                 //0x1E
+	{"CALL",  MODE_A12, 2, 2},                 //0x1F
+	{"CALLF", MODE_A16, 3, 2},                 //0x20
+	{"JMPF",  MODE_A16, 3, 2},                 //0x21
+	{"MOV",   MODE_I8_D9, 3, 2},               //0x22
+	{"MOV",   MODE_I8_D9, 3, 2},               //0x23
+	{"MOV",   MODE_I8_R, 2, 1},                //0x24
+	{"MOV",   MODE_I8_R, 2, 1},                //0x25
+	{"MOV",   MODE_I8_R, 2, 1},                //0x26
+	{"MOV",   MODE_I8_R, 2, 1},                //0x27
+	{"JMP",   MODE_A12, 2, 2},                 //0x28
+	{"JMP",   MODE_A12, 2, 2},                 //0x29
+	{"JMP",   MODE_A12, 2, 2},                 //0x2A
+	{"JMP",   MODE_A12, 2, 2},                 //0x2B
+	{"JMP",   MODE_A12, 2, 2},                 //0x2C
+	{"JMP",   MODE_A12, 2, 2},                 //0x2D
+	{"JMP",   MODE_A12, 2, 2},                 //0x2E
+	{"JMP",   MODE_A12, 2, 2},                 //0x2F
+	{"MUL",   MODE_NONE, 1, 7},                //0x30
+	{"BE",    MODE_I8_R8, 3, 2},               //0x31
+	{"BE",    MODE_D9_R8, 3, 2},               //0x32
+	{"BE",    MODE_D9_R8, 3, 2},               //0x33
+	{"BE",    MODE_R_I8_R8, 3, 2},             //0x34
+	{"BE",    MODE_R_I8_R8, 3, 2},             //0x35
+	{"BE",    MODE_R_I8_R8, 3, 2},             //0x36
+	{"BE",    MODE_R_I8_R8, 3, 2},             //0x37
+	{"JMP",   MODE_A12, 2, 2},                 //0x38
+	{"JMP",   MODE_A12, 2, 2},                 //0x39
+	{"JMP",   MODE_A12, 2, 2},                 //0x3A
+	{"JMP",   MODE_A12, 2, 2},                 //0x3B
+	{"JMP",   MODE_A12, 2, 2},                 //0x3C
+	{"JMP",   MODE_A12, 2, 2},                 //0x3D
+	{"JMP",   MODE_A12, 2, 2},                 //0x3E
+	{"JMP",   MODE_A12, 2, 2},                 //0x3F
+	{"DIV",   MODE_NONE, 1, 7},                //0x40
+	{"BNE",   MODE_I8_R8, 3, 2},               //0x41
+	{"BNE",   MODE_D9_R8, 3, 2},               //0x42
+	{"BNE",   MODE_D9_R8, 3, 2},               //0x43
+	{"BNE",   MODE_R_I8_R8, 3, 2},             //0x44
+	{"BNE",   MODE_R_I8_R8, 3, 2},             //0x45
+	{"BNE",   MODE_R_I8_R8, 3, 2},             //0x46
+	{"BNE",   MODE_R_I8_R8, 3, 2},             //0x47
+	{"BPC",   MODE_D9_B3_R8, 3, 2},            //0x48
+	{"BPC",   MODE_D9_B3_R8, 3, 2},            //0x49
+	{"BPC",   MODE_D9_B3_R8, 3, 2},            //0x4A
+	{"BPC",   MODE_D9_B3_R8, 3, 2},            //0x4B
+	{"BPC",   MODE_D9_B3_R8, 3, 2},            //0x4C
+	{"BPC",   MODE_D9_B3_R8, 3, 2},            //0x4D
+	{"BPC",   MODE_D9_B3_R8, 3, 2},            //0x4E
+	{"BPC",   MODE_D9_B3_R8, 3, 2},            //0x4F
+	{"LDF",   MODE_NONE, 1, 2},                //0x50
+	{"STF",   MODE_NONE, 1, 2},                //0x51
+	{"DBNZ",  MODE_D9_R8, 3, 2},               //0x52
+	{"DBNZ",  MODE_D9_R8, 3, 2},               //0x53
+	{"DBNZ",  MODE_R_R8, 2, 2},                //0x54
+	{"DBNZ",  MODE_R_R8, 2, 2},                //0x55
+	{"DBNZ",  MODE_R_R8, 2, 2},                //0x56
+	{"DBNZ",  MODE_R_R8, 2, 2},                //0x57
+	{"BPC",   MODE_D9_B3_R8, 3, 2},            //0x58
+	{"BPC",   MODE_D9_B3_R8, 3, 2},            //0x59
+	{"BPC",   MODE_D9_B3_R8, 3, 2},            //0x5A
+	{"BPC",   MODE_D9_B3_R8, 3, 2},            //0x5B
+	{"BPC",   MODE_D9_B3_R8, 3, 2},            //0x5C
+	{"BPC",   MODE_D9_B3_R8, 3, 2},            //0x5D
+	{"BPC",   MODE_D9_B3_R8, 3, 2},            //0x5E
+	{"BPC",   MODE_D9_B3_R8, 3, 2},            //0x5F
+	{"PUSH",  MODE_D9, 2, 2},                  //0x60
+	{"PUSH",  MODE_D9, 2, 2},                  //0x61
+	{"INC",   MODE_D9, 2, 1},                  //0x62
+	{"INC",   MODE_D9, 2, 1},                  //0x63
+	{"INC",   MODE_R, 1, 1},                   //0x64
+	{"INC",   MODE_R, 1, 1},                   //0x65
+	{"INC",   MODE_R, 1, 1},                   //0x66
+	{"INC",   MODE_R, 1, 1},                   //0x67
+	{"BP",    MODE_D9_B3_R8, 3, 2},            //0x68
+	{"BP",    MODE_D9_B3_R8, 3, 2},            //0x69
+	{"BP",    MODE_D9_B3_R8, 3, 2},            //0x6A
+	{"BP",    MODE_D9_B3_R8, 3, 2},            //0x6B
+	{"BP",    MODE_D9_B3_R8, 3, 2},            //0x6C
+	{"BP",    MODE_D9_B3_R8, 3, 2},            //0x6D
+	{"BP",    MODE_D9_B3_R8, 3, 2},            //0x6E
+	{"BP",    MODE_D9_B3_R8, 3, 2},            //0x6F
+	{"POP",   MODE_D9, 2, 2},                  //0x70
+	{"POP",   MODE_D9, 2, 2},                  //0x71
+	{"DEC",   MODE_D9, 2, 1},                  //0x72
+	{"DEC",   MODE_D9, 2, 1},                  //0x73
+	{"DEC",   MODE_R, 1, 1},                   //0x74
+	{"DEC",   MODE_R, 1, 1},                   //0x75
+	{"DEC",   MODE_R, 1, 1},                   //0x76
+	{"DEC",   MODE_R, 1, 1},                   //0x77
+	{"BP",    MODE_D9_B3_R8, 3, 2},            //0x78
+	{"BP",    MODE_D9_B3_R8, 3, 2},            //0x79
+	{"BP",    MODE_D9_B3_R8, 3, 2},            //0x7A
+	{"BP",    MODE_D9_B3_R8, 3, 2},            //0x7B
+	{"BP",    MODE_D9_B3_R8, 3, 2},            //0x7C
+	{"BP",    MODE_D9_B3_R8, 3, 2},            //0x7D
+	{"BP",    MODE_D9_B3_R8, 3, 2},            //0x7E
+	{"BP",    MODE_D9_B3_R8, 3, 2},            //0x7F
+	{"BZ",    MODE_R8, 2, 2},                  //0x80
+	{"ADD",   MODE_I8, 2, 1},                  //0x81
+	{"ADD",   MODE_D9, 2, 1},                  //0x82
+	{"ADD",   MODE_D9, 2, 1},                  //0x83
+	{"ADD",   MODE_R, 1, 1},                   //0x84
+	{"ADD",   MODE_R, 1, 1},                   //0x85
+	{"ADD",   MODE_R, 1, 1},                   //0x86
+	{"ADD",   MODE_R, 1, 1},                   //0x87
+	{"BN",    MODE_D9_B3_R8, 3, 2},            //0x88
+	{"BN",    MODE_D9_B3_R8, 3, 2},            //0x89
+	{"BN",    MODE_D9_B3_R8, 3, 2},            //0x8A
+	{"BN",    MODE_D9_B3_R8, 3, 2},            //0x8B
+	{"BN",    MODE_D9_B3_R8, 3, 2},            //0x8C
+	{"BN",    MODE_D9_B3_R8, 3, 2},            //0x8D
+	{"BN",    MODE_D9_B3_R8, 3, 2},            //0x8E
+	{"BN",    MODE_D9_B3_R8, 3, 2},            //0x8F
+	{"BNZ",   MODE_R8, 2, 2},                  //0x90
+	{"ADDC",  MODE_I8, 2, 1},                  //0x91
+	{"ADDC",  MODE_D9, 2, 1},                  //0x92
+	{"ADDC",  MODE_D9, 2, 1},                  //0x93
+	{"ADDC",  MODE_R, 1, 1},                   //0x94
+	{"ADDC",  MODE_R, 1, 1},                   //0x95
+	{"ADDC",  MODE_R, 1, 1},                   //0x96
+	{"ADDC",  MODE_R, 1, 1},                   //0x97
+	{"BN",    MODE_D9_B3_R8, 3, 2},            //0x98
+	{"BN",    MODE_D9_B3_R8, 3, 2},            //0x99
+	{"BN",    MODE_D9_B3_R8, 3, 2},            //0x9A
+	{"BN",    MODE_D9_B3_R8, 3, 2},            //0x9B
+	{"BN",    MODE_D9_B3_R8, 3, 2},            //0x9C
+	{"BN",    MODE_D9_B3_R8, 3, 2},            //0x9D
+	{"BN",    MODE_D9_B3_R8, 3, 2},            //0x9E
+	{"BN",    MODE_D9_B3_R8, 3, 2},            //0x9F
+	{"RET",   MODE_NONE, 1, 2},                //0xA0
+	{"SUB",   MODE_I8, 2, 1},                  //0xA1
+	{"SUB",   MODE_D9, 2, 1},                  //0xA2
+	{"SUB",   MODE_D9, 2, 1},                  //0xA3
+	{"SUB",   MODE_R, 1, 1},                   //0xA4
+	{"SUB",   MODE_R, 1, 1},                   //0xA5
+	{"SUB",   MODE_R, 1, 1},                   //0xA6
+	{"SUB",   MODE_R, 1, 1},                   //0xA7
+	{"NOT1",  MODE_D9_B3, 2, 1},               //0xA8
+	{"NOT1",  MODE_D9_B3, 2, 1},               //0xA9
+	{"NOT1",  MODE_D9_B3, 2, 1},               //0xAA
+	{"NOT1",  MODE_D9_B3, 2, 1},               //0xAB
+	{"NOT1",  MODE_D9_B3, 2, 1},               //0xAC
+	{"NOT1",  MODE_D9_B3, 2, 1},               //0xAD
+	{"NOT1",  MODE_D9_B3, 2, 1},               //0xAE
+	{"NOT1",  MODE_D9_B3, 2, 1},               //0xAF
+	{"RETI",  MODE_NONE, 1, 2},                //0xB0
+	{"SUBC",  MODE_I8, 2, 1},                  //0xB1
+	{"SUBC",  MODE_D9, 2, 1},                  //0xB2
+	{"SUBC",  MODE_D9, 2, 1},                  //0xB3
+	{"SUBC",  MODE_R, 1, 1},                   //0xB4
+	{"SUBC",  MODE_R, 1, 1},                   //0xB5
+	{"SUBC",  MODE_R, 1, 1},                   //0xB6
+	{"SUBC",  MODE_R, 1, 1},                   //0xB7
+	{"NOT1",  MODE_D9_B3, 2, 1},               //0xB8
+	{"NOT1",  MODE_D9_B3, 2, 1},               //0xB9
+	{"NOT1",  MODE_D9_B3, 2, 1},               //0xBA
+	{"NOT1",  MODE_D9_B3, 2, 1},               //0xBB
+	{"NOT1",  MODE_D9_B3, 2, 1},               //0xBC
+	{"NOT1",  MODE_D9_B3, 2, 1},               //0xBD
+	{"NOT1",  MODE_D9_B3, 2, 1},               //0xBE
+	{"NOT1",  MODE_D9_B3, 2, 1},               //0xBF
+	{"ROR",   MODE_NONE, 1, 1},                //0xC0
+	{"LDC",   MODE_NONE, 1, 2},                //0xC1
+	{"XCH",   MODE_D9, 2, 1},                  //0xC2
+	{"XCH",   MODE_D9, 2, 1},                  //0xC3
+	{"XCH",   MODE_R, 1, 1},                   //0xC4
+	{"XCH",   MODE_R, 1, 1},                   //0xC5
+	{"XCH",   MODE_R, 1, 1},                   //0xC6
+	{"XCH",   MODE_R, 1, 1},                   //0xC7
+	{"CLR1",  MODE_D9_B3, 2, 1},               //0xC8
+	{"CLR1",  MODE_D9_B3, 2, 1},               //0xC9
+	{"CLR1",  MODE_D9_B3, 2, 1},               //0xCA
+	{"CLR1",  MODE_D9_B3, 2, 1},               //0xCB
+	{"CLR1",  MODE_D9_B3, 2, 1},               //0xCC
+	{"CLR1",  MODE_D9_B3, 2, 1},               //0xCD
+	{"CLR1",  MODE_D9_B3, 2, 1},               //0xCE
+	{"CLR1",  MODE_D9_B3, 2, 1},               //0xCF
+	{"RORC",  MODE_NONE, 1, 1},                //0xD0
+	{"OR",    MODE_I8, 2, 1},                  //0xD1
+	{"OR",    MODE_D9, 2, 1},                  //0xD2
+	{"OR",    MODE_D9, 2, 1},                  //0xD3
+	{"OR",    MODE_R, 1, 1},                   //0xD4
+	{"OR",    MODE_R, 1, 1},                   //0xD5
+	{"OR",    MODE_R, 1, 1},                   //0xD6
+	{"OR",    MODE_R, 1, 1},                   //0xD7
+	{"CLR1",  MODE_D9_B3, 2, 1},               //0xD8
+	{"CLR1",  MODE_D9_B3, 2, 1},               //0xD9
+	{"CLR1",  MODE_D9_B3, 2, 1},               //0xDA
+	{"CLR1",  MODE_D9_B3, 2, 1},               //0xDB
+	{"CLR1",  MODE_D9_B3, 2, 1},               //0xDC
+	{"CLR1",  MODE_D9_B3, 2, 1},               //0xDD
+	{"CLR1",  MODE_D9_B3, 2, 1},               //0xDE
+	{"CLR1",  MODE_D9_B3, 2, 1},               //0xDF
+	{"ROL",   MODE_NONE, 1, 1},                //0xE0
+	{"AND",   MODE_I8, 2, 1},                  //0xE1
+	{"AND",   MODE_D9, 2, 1},                  //0xE2
+	{"AND",   MODE_D9, 2, 1},                  //0xE3
+	{"AND",   MODE_R, 1, 1},                   //0xE4
+	{"AND",   MODE_R, 1, 1},                   //0xE5
+	{"AND",   MODE_R, 1, 1},                   //0xE6
+	{"AND",   MODE_R, 1, 1},                   //0xE7
+	{"SET1",  MODE_D9_B3, 2, 1},               //0xE8
+	{"SET1",  MODE_D9_B3, 2, 1},               //0xE9
+	{"SET1",  MODE_D9_B3, 2, 1},               //0xEA
+	{"SET1",  MODE_D9_B3, 2, 1},               //0xEB
+	{"SET1",  MODE_D9_B3, 2, 1},               //0xEC
+	{"SET1",  MODE_D9_B3, 2, 1},               //0xED
+	{"SET1",  MODE_D9_B3, 2, 1},               //0xEE
+	{"SET1",  MODE_D9_B3, 2, 1},               //0xEF
+	{"ROLC",  MODE_NONE, 1, 1},                //0xF0
+	{"XOR",   MODE_I8, 2, 1},                  //0xF1
+	{"XOR",   MODE_D9, 2, 1},                  //0xF2
+	{"XOR",   MODE_D9, 2, 1},                  //0xF3
+	{"XOR",   MODE_R, 1, 1},                   //0xF4
+	{"XOR",   MODE_R, 1, 1},                   //0xF5
+	{"XOR",   MODE_R, 1, 1},                   //0xF6
+	{"XOR",   MODE_R, 1, 1},                   //0xF7
+	{"SET1",  MODE_D9_B3, 2, 1},               //0xF8
+	{"SET1",  MODE_D9_B3, 2, 1},               //0xF9
+	{"SET1",  MODE_D9_B3, 2, 1},               //0xFA
+	{"SET1",  MODE_D9_B3, 2, 1},               //0xFB
+	{"SET1",  MODE_D9_B3, 2, 1},               //0xFC
+	{"SET1",  MODE_D9_B3, 2, 1},               //0xFD
+	{"SET1",  MODE_D9_B3, 2, 1},               //0xFE
+	{"SET1",  MODE_D9_B3, 2, 1}                //0xFF
+};
+
+//Writes instruction as text to out (Needs at least 32 bytes), address is where the instruction is located.
+void formatInstruction(const VE_VMS_INSTRUCTION &inst, size_t address, char *out)
+{
+	const VE_VMS_OPCODE &op = opcodeTable[inst.opcode];
+
+	//Branch targets are relative to the next instruction
+	size_t next = (address + inst.length) & 0xFFFF;
+	size_t target = (next + inst.r8) & 0xFFFF;
+
+	switch(op.mode)
+	{
+		case MODE_I8:
+			sprintf(out, "%s #$%02X", op.mnemonic, inst.i8);
+			break;
+		case MODE_D9:
+			sprintf(out, "%s $%03X", op.mnemonic, inst.d9);
+			break;
+		case MODE_R:
+			sprintf(out, "%s @R%d", op.mnemonic, inst.Ri);
+			break;
+		case MODE_I8_D9:
+			sprintf(out, "%s #$%02X, $%03X", op.mnemonic, inst.i8, inst.d9);
+			break;
+		case MODE_I8_R:
+			sprintf(out, "%s #$%02X, @R%d", op.mnemonic, inst.i8, inst.Ri);
+			break;
+		case MODE_D9_B3:
+			sprintf(out, "%s $%03X, %d", op.mnemonic, inst.d9, inst.b3);
+			break;
+		case MODE_D9_B3_R8:
+			sprintf(out, "%s $%03X, %d, $%04X", op.mnemonic, inst.d9, inst.b3, (unsigned)target);
+			break;
+		case MODE_R8:
+			sprintf(out, "%s $%04X", op.mnemonic, (unsigned)target);
+			break;
+		case MODE_R16:
+			//Relative to the last byte of the instruction
+			sprintf(out, "%s $%04X", op.mnemonic, (unsigned)((next - 1 + inst.a16) & 0xFFFF));
+			break;
+		case MODE_I8_R8:
+			sprintf(out, "%s #$%02X, $%04X", op.mnemonic, inst.i8, (unsigned)target);
+			break;
+		case MODE_D9_R8:
+			sprintf(out, "%s $%03X, $%04X", op.mnemonic, inst.d9, (unsigned)target);
+			break;
+		case MODE_R_R8:
+			sprintf(out, "%s @R%d, $%04X", op.mnemonic, inst.Ri, (unsigned)target);
+			break;
+		case MODE_R_I8_R8:
+			sprintf(out, "%s @R%d, #$%02X, $%04X", op.mnemonic, inst.Ri, inst.i8, (unsigned)target);
+			break;
+		case MODE_A12:
+			sprintf(out, "%s $%04X", op.mnemonic, (unsigned)((next & 0xF000) | inst.a16));
+			break;
+		case MODE_A16:
+			sprintf(out, "%s $%04X", op.mnemonic, inst.a16);
+			break;
+		default:
+			sprintf(out, "%s", op.mnemonic);
+	}
+}
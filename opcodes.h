@@ -0,0 +1,73 @@
+/*
+    VeMUlator - A Dreamcast Visual Memory Unit emulator for libretro
+    Copyright (C) 2018  Mahmoud Jaoune
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef _OPCODES_H_
+#define _OPCODES_H_
+
+#include "common.h"
+
+//Addressing modes, they decide which operands follow the opcode and how they are decoded
+enum VE_VMS_ADDRESSING_MODE
+{
+	MODE_NONE,          //No operands
+	MODE_I8,            //#i8
+	MODE_D9,            //d9 (9th bit in opcode)
+	MODE_R,             //@Ri
+	MODE_I8_D9,         //#i8, d9 (d9 comes first in memory)
+	MODE_I8_R,          //#i8, @Ri
+	MODE_D9_B3,         //d9, b3 (9th bit in bit 4 of opcode)
+	MODE_D9_B3_R8,      //d9, b3, r8
+	MODE_R8,            //r8
+	MODE_R16,           //r16 (Little-endian)
+	MODE_I8_R8,         //#i8, r8
+	MODE_D9_R8,         //d9, r8
+	MODE_R_R8,          //@Ri, r8
+	MODE_R_I8_R8,       //@Ri, #i8, r8
+	MODE_A12,           //a12 (Bits 9-12 in opcode)
+	MODE_A16            //a16 (Big-endian)
+};
+
+//Static description of an opcode, shared by the interpreter, the tracer and the disassembler
+struct VE_VMS_OPCODE
+{
+	const char *mnemonic;
+	byte mode;
+	byte length;    //In bytes
+	byte cycles;    //Base cycles
+};
+
+//A decoded instruction (Operands already extracted from code memory)
+struct VE_VMS_INSTRUCTION
+{
+	byte opcode;
+	byte length;
+	byte cycles;
+	byte b3;            //Bit number
+	byte i8;            //Immediate
+	byte Ri;            //Indirection register (0-3)
+	signed char r8;     //Relative 8-bit
+	uint16_t d9;        //Direct 9-bit
+	uint16_t a16;       //a12, a16 or r16
+};
+
+extern const VE_VMS_OPCODE opcodeTable[256];
+
+//Writes instruction as text to out (Needs at least 32 bytes), address is where the instruction is located.
+void formatInstruction(const VE_VMS_INSTRUCTION &inst, size_t address, char *out);
+
+#endif // _OPCODES_H_
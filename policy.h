@@ -0,0 +1,67 @@
+/*
+    VeMUlator - A Dreamcast Visual Memory Unit emulator for libretro
+    Copyright (C) 2018  Mahmoud Jaoune
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef _POLICY_H_
+#define _POLICY_H_
+
+//Policies are picked once when a game is loaded. CPU and run loop are compiled for each of them,
+//so nothing they select is tested while instructions run.
+
+//System software, decides what a jump into ROM does
+struct VE_VMS_HLE       //No BIOS, system calls are emulated
+{
+    static const bool hle = true;
+};
+
+struct VE_VMS_BIOS      //Real BIOS in ROM
+{
+    static const bool hle = false;
+};
+
+//Instruction trace (Disassembly of each interpreted instruction is printed before it runs)
+struct VE_VMS_TRACE_OFF
+{
+    static const bool enabled = false;
+};
+
+struct VE_VMS_TRACE_ON
+{
+    static const bool enabled = true;
+};
+
+//Accuracy tiers of block engines (Timers see a block as one point in time, the interpreter sees each instruction)
+struct VE_VMS_BLOCKS_INTERPRETED    //Superblocks
+{
+    static const bool native = false;
+    static const bool verify = false;
+};
+
+struct VE_VMS_BLOCKS_NATIVE         //JIT
+{
+    static const bool native = true;
+    static const bool verify = false;
+};
+
+struct VE_VMS_BLOCKS_VERIFIED       //JIT checked against the interpreter
+{
+    static const bool native = true;
+    static const bool verify = true;
+};
+
+#endif // _POLICY_H_
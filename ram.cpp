@@ -16,7 +16,10 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <string.h>
 #include "ram.h"
+#include "alu.h"
+#include "scheduler.h"
 
 VE_VMS_RAM::VE_VMS_RAM()
 {
@@ -25,12 +28,52 @@ VE_VMS_RAM::VE_VMS_RAM()
     
 	data = new byte[1024];
     wram = new byte[512];
-    xram0 = new byte[0x7C];
-    xram1 = new byte[0x7C];
-    xram2 = new byte[0x7C];
+    xram0 = new byte[RAM_XRAM_ALLOCATED]();
+    xram1 = new byte[RAM_XRAM_ALLOCATED]();
+    xram2 = new byte[RAM_XRAM_ALLOCATED]();
     
     T1RL_data = 0;
     T1RH_data = 0;
+
+    flagTable = NULL;
+    flagIndex = 0;
+
+    romMemory = NULL;
+    flashMemory = NULL;
+    codeBank = NULL;
+    flashBank = 0;
+    flashWriteProtected = false;
+
+    pages[2] = data + 0x100;    //SFR are never banked
+
+    displayGeneration = 0;
+
+    scheduler = NULL;
+
+    for(size_t i = 0; i < RAM_DIRECT_SIZE; i++)
+    {
+        observers[i] = NULL;
+
+        if(i < 0x100) access[i] = RAM_ACCESS_MAIN;
+        else if(i >= XRAM && i <= 0x1FB) access[i] = RAM_ACCESS_XRAM;
+        else if(isTimerSFR(i)) access[i] = RAM_ACCESS_TIMER;
+        else access[i] = RAM_ACCESS_PLAIN;
+    }
+
+    access[PSW] = RAM_ACCESS_PSW;
+    access[EXT] = RAM_ACCESS_BANK;
+    access[FPR] = RAM_ACCESS_BANK;
+    access[XBNK] = RAM_ACCESS_BANK;
+    access[STAD] = RAM_ACCESS_BANK;
+    access[T1LR] = RAM_ACCESS_T1RELOAD;
+    access[T1HR] = RAM_ACCESS_T1RELOAD;
+    access[T1LC] = RAM_ACCESS_T1COMPARE;
+    access[T1HC] = RAM_ACCESS_T1COMPARE;
+    access[VTRBF] = RAM_ACCESS_VTRBF;
+    access[MCR] = RAM_ACCESS_DISPLAY;
+    access[VCCR] = RAM_ACCESS_DISPLAY;
+
+    updateBanks();
 }
 
 VE_VMS_RAM::~VE_VMS_RAM()
@@ -43,62 +86,33 @@ VE_VMS_RAM::~VE_VMS_RAM()
 }
 
 //Setters and getters
+///Address is 9-bit, only addresses with side effects or banking need more than an indexed load
 byte VE_VMS_RAM::readByte(size_t adr)
 {
-	//printf("Reading raw address %ul\n", adr);
-	size_t xaddress = adr + (data[STAD] & 0xFF);    //Remove start address of XRAM
-	size_t address = adr;
-
-	//If first half of ram is accessed (Not SFR), check Bank to choose whether to access first bank of RAM or second.
-	//Second bank starts at 256
-	if(address < 0x100) 
-	{
-		byte mainBank = ((data[PSW] & 0x2) >> 1) & 0x1; //Get RAM bank
-
-		if(mainBank == 1) address += 512;
-	}
-	//If XRAM is accessed, we choose the address depending on XBNK SFR.
-	else if(address >= 0x180 && address <= 0x1FB)
-	{
-		byte XRAMBank = data[XBNK] & 0xFF;
-
-		switch(XRAMBank)
-		{
-			case 0:
-				return xram0[xaddress - 0x180] & 0xFF;
-			case 1:
-				return xram1[xaddress - 0x180] & 0xFF;
-			case 2:
-				return xram2[xaddress - 0x180] & 0xFF;
-			default:
-				return xram0[xaddress - 0x180] & 0xFF;
-		}
-	}
-
-	//Work RAM access
-	if(adr == 0x166) 
+	switch(access[adr] & RAM_ACCESS_KIND)
 	{
-		byte VSEL_ = data[VSEL] & 0xFF;
-		size_t VRMAD = (data[VRMAD1] | (data[VRMAD2] << 8)) & 0x1FF;
-		size_t VRMAD_original = VRMAD;
-
-		//Check if auto increment is enabled
-		if((VSEL_ & 16) != 0)
-		{
-			VRMAD++;
-			data[VRMAD1] = VRMAD & 0xFF;
-			data[VRMAD2] = (VRMAD >> 8) & 1;
-		}
-		//printf("Work ram buffer accessed! Read\n");
-
-		return (wram[VRMAD_original] & 0xFF);
+		//Banked memory is found through its page
+		case RAM_ACCESS_MAIN:
+		case RAM_ACCESS_XRAM:
+			return pages[adr / RAM_PAGE_SIZE][adr % RAM_PAGE_SIZE];
+		//Software sees flags of last ALU operation
+		case RAM_ACCESS_PSW:
+			syncFlags();
+			break;
+		//Software sees timers as of this cycle
+		case RAM_ACCESS_TIMER:
+			if(scheduler != NULL) scheduler->sync();
+			break;
+		//T1 reload registers are the same as T1, so we need to separate them
+		case RAM_ACCESS_T1RELOAD:
+			if(scheduler != NULL) scheduler->sync();
+			return adr == T1LR ? T1RL_data : T1RH_data;
+		//Work RAM access
+		case RAM_ACCESS_VTRBF:
+			return wram[nextVRMAD()];
 	}
 
-
-	if(adr != T1LR && adr != T1HR)    //T1 reload registers are the same as T1, so we need to separate them
-		return (data[address] & 0xFF);
-	else if(adr == T1LR) return T1RL_data & 0xFF;
-	else return T1RH_data & 0xFF;
+	return data[adr];
 }
 
 //No banking or checking, use carefully!
@@ -125,75 +139,77 @@ byte VE_VMS_RAM::readByteXRAM(size_t adr, int bank)
 	}
 }
 
+///Address is 9-bit, only addresses with side effects or banking need more than an indexed store
 void VE_VMS_RAM::writeByte(size_t adr, byte b)
 {
-	//printf("Writing raw address %ul\n", adr);
-	size_t xaddress = adr + (data[STAD] & 0xFF);
-	size_t address = adr;
-
-	//If first half of ram is accessed (Not SFR), check Bank to choose whether to access first bank of RAM or second.
-	//Second bank starts at 256
-	if(address < 0x100) 
-	{
-		byte mainBank = ((data[PSW] & 0x2) >> 1) & 0x1; //Get RAM bank
+	byte kind = access[adr];
 
-		if(mainBank == 1) address += 512;   //To access second bank in "data[]"
-	}
-	//If XRAM is accessed, we choose the address depending on XBNK SFR.
-	else if(address >= 0x180 && address <= 0x1FB)
+	if(kind == RAM_ACCESS_PLAIN)
 	{
-		byte XRAMBank = data[XBNK] & 0xFF;
-
-		switch(XRAMBank)
-		{
-			case 0:
-				//VMU_Debug.debugGFX("Writing to XRAM Bank 0, Data= " + Integer.toHexString(b & 0xFF));
-				xram0[xaddress - 0x180] = b & 0xFF;
-				return;
-			case 1:
-				//VMU_Debug.debugGFX("Writing to XRAM Bank 1, Data= " + Integer.toHexString(b & 0xFF));
-				xram1[xaddress - 0x180] = b & 0xFF;
-				return;
-			case 2:
-				//VMU_Debug.debugGFX("Writing to XRAM Bank 2, Data= " + Integer.toHexString(b & 0xFF));
-				xram2[xaddress - 0x180] = b & 0xFF;
-				return;
-			default:
-				//VMU_Debug.debugGFX("(Fault) Writing to XRAM Bank 0, Data= " + Integer.toHexString(b & 0xFF));
-				xram0[xaddress - 0x180] = b & 0xFF;
-				return;
-		}
+		data[adr] = b;
+		return;
 	}
 
-	//Work RAM access
-	if(adr == 0x166) 
+	//Banked memory is found through its page
+	if(kind == RAM_ACCESS_MAIN)
 	{
-		byte VSEL_ = data[VSEL] & 0xFF;
-		size_t VRMAD = (data[VRMAD1] | (data[VRMAD2] << 8)) & 0x1FF;
-		size_t VRMAD_original = VRMAD;
-
-		//Check if auto increment is enabled
-		if((VSEL_ & 16) != 0)
-		{
-			VRMAD++;
-			data[VRMAD1] = VRMAD & 0xFF;
-			data[VRMAD2] = (VRMAD >> 8) & 1;
-		}
-		//printf("Work ram buffer accessed! Write");
-
-		wram[VRMAD_original] = b & 0xFF;
+		pages[adr / RAM_PAGE_SIZE][adr % RAM_PAGE_SIZE] = b;
 		return;
 	}
 
-	if(address != T1LC && address != T1HC) 
+	size_t address = adr;
+
+	switch(kind & RAM_ACCESS_KIND)
 	{
-		data[address] = b & 0xFF;
-		return;
+		//Observed main RAM, only bank 0 is observed
+		case RAM_ACCESS_MAIN:
+			address += (data[PSW] & 2) << 8;
+			data[address] = b;
+			break;
+		//Display memory
+		case RAM_ACCESS_XRAM:
+			pages[adr / RAM_PAGE_SIZE][adr % RAM_PAGE_SIZE] = b;
+			displayGeneration++;
+			return;
+		//Whole PSW is replaced, pending flags are dropped (RAM bank and IRBK may change)
+		case RAM_ACCESS_PSW:
+			flagTable = NULL;
+			data[adr] = b;
+			updateBanks();
+			break;
+		//Bank switch (STAD also moves the display window)
+		case RAM_ACCESS_BANK:
+			data[adr] = b;
+			updateBanks();
+			if(adr == STAD) displayGeneration++;
+			break;
+		//LCD control
+		case RAM_ACCESS_DISPLAY:
+			data[adr] = b;
+			displayGeneration++;
+			break;
+		//Timers catch up before their state changes, then their events are computed again
+		case RAM_ACCESS_TIMER:
+		case RAM_ACCESS_T1RELOAD:
+			if(scheduler != NULL) scheduler->sync();
+			data[adr] = b;
+			if(scheduler != NULL) scheduler->reschedule();
+			break;
+		//T1LC and T1HC are updated only when bit4 of T1CNT is enabled (Their observer latches them)
+		case RAM_ACCESS_T1COMPARE:
+			if(adr == T1LC) T1LC_Temp = b;
+			else T1HC_Temp = b;
+			break;
+		//Work RAM access
+		case RAM_ACCESS_VTRBF:
+			wram[nextVRMAD()] = b;
+			return;
+		default:
+			data[adr] = b;
+			break;
 	}
 
-	//T1LC and T1HC are updated only when bit4 of T1CNT is enabled (This is checked each cycle).
-	if(address == T1LC) T1LC_Temp = b & 0xFF;
-	else T1HC_Temp = b & 0xFF;
+	if((kind & RAM_ACCESS_OBSERVED) != 0) notifyObserver(address, b);
 }
 
 void VE_VMS_RAM::writeByte_RAW(size_t adr, byte b)
@@ -206,6 +222,8 @@ void VE_VMS_RAM::stackPush(byte d)
 {
 	data[SP] += 1;
 	data[data[SP]] = d & 0xFF;
+
+	notifyObserver(data[SP], d);
 }
 
 byte VE_VMS_RAM::stackPop()
@@ -219,3 +237,132 @@ byte *VE_VMS_RAM::getData()
 	return data;
 }
 
+byte *VE_VMS_RAM::getWRAM()
+{
+	return wram;
+}
+
+byte *VE_VMS_RAM::getXRAM(int bank)
+{
+	switch(bank)
+	{
+		case 1:
+			return xram1;
+		case 2:
+			return xram2;
+		default:
+			return xram0;
+	}
+}
+
+///Work RAM address VTRBF accesses, VRMAD is incremented after it when bit 4 of VSEL is set
+size_t VE_VMS_RAM::nextVRMAD()
+{
+	size_t VRMAD = (data[VRMAD1] | (data[VRMAD2] << 8)) & 0x1FF;
+
+	if((data[VSEL] & 16) != 0)
+	{
+		size_t next = VRMAD + 1;
+		data[VRMAD1] = next & 0xFF;
+		data[VRMAD2] = (next >> 8) & 1;
+	}
+
+	return VRMAD;
+}
+
+///Observer is called after software writes address, NULL removes it
+void VE_VMS_RAM::setObserver(size_t address, VE_VMS_SFR_OBSERVER *observer)
+{
+	if(address >= RAM_DIRECT_SIZE) return;
+
+	observers[address] = observer;
+
+	if(observer != NULL) access[address] |= RAM_ACCESS_OBSERVED;
+	else access[address] &= ~RAM_ACCESS_OBSERVED;
+}
+
+///Notifies observers of addresses in a range written without writeByte (Bulk transfers)
+void VE_VMS_RAM::notifyObservers(size_t address, size_t count)
+{
+	for(size_t i = address; i < address + count; i++)
+		notifyObserver(i, data[i]);
+}
+
+///Writes pending ALU flags into PSW (CY: bit 7, AC: bit 6, OV: bit 2)
+void VE_VMS_RAM::syncFlags()
+{
+	if(flagTable == NULL) return;
+
+	byte flags = flagTable[flagIndex];
+
+	data[PSW] = (data[PSW] & 0x3B) | ((flags & ALU_CY) << 7) | ((flags & ALU_AC) << 5) | (flags & ALU_OV);
+	flagTable = NULL;
+}
+
+///Sets ROM and flash images that EXT selects code from
+void VE_VMS_RAM::setCodeMemory(const byte *rom, const byte *flash)
+{
+	romMemory = rom;
+	flashMemory = flash;
+
+	updateBanks();
+}
+
+///Recomputes bank state, called whenever EXT, FPR, PSW, XBNK or STAD is written
+void VE_VMS_RAM::updateBanks()
+{
+	codeBank = (data[EXT] & 1) ? flashMemory : romMemory;
+	flashBank = (data[FPR] & 1) ? 0x10000 : 0;
+	flashWriteProtected = (data[FPR] & 2) != 0;
+
+	//Second bank of main RAM starts at 512 in data
+	byte *mainRAM = data + ((data[PSW] & 2) << 8);
+	pages[0] = mainRAM;
+	pages[1] = mainRAM + RAM_PAGE_SIZE;
+
+	//XRAM starts at STAD in bank selected by XBNK (0-2, anything else is bank 0)
+	byte *xram = (data[XBNK] == 1) ? xram1 : (data[XBNK] == 2) ? xram2 : xram0;
+	pages[3] = xram + data[STAD];
+
+	indirectRegisters = mainRAM + (((data[PSW] >> 3) & 3) << 2);
+}
+
+//Copies whole RAM (Including work RAM and XRAM) to a buffer of RAM_STATE_SIZE bytes
+void VE_VMS_RAM::saveState(byte *out)
+{
+	syncFlags();
+
+	memcpy(out, data, 1024);
+	memcpy(out + 1024, wram, 512);
+	memcpy(out + 1536, xram0, RAM_XRAM_ALLOCATED);
+	memcpy(out + 1536 + RAM_XRAM_ALLOCATED, xram1, RAM_XRAM_ALLOCATED);
+	memcpy(out + 1536 + 2*RAM_XRAM_ALLOCATED, xram2, RAM_XRAM_ALLOCATED);
+
+	byte *extra = out + 1536 + 3*RAM_XRAM_ALLOCATED;
+	extra[0] = T1LC_Temp;
+	extra[1] = T1HC_Temp;
+	extra[2] = T1RL_data;
+	extra[3] = T1RH_data;
+}
+
+//Restores RAM from a buffer of RAM_STATE_SIZE bytes
+void VE_VMS_RAM::loadState(const byte *in)
+{
+	flagTable = NULL;
+
+	memcpy(data, in, 1024);
+	memcpy(wram, in + 1024, 512);
+	memcpy(xram0, in + 1536, RAM_XRAM_ALLOCATED);
+	memcpy(xram1, in + 1536 + RAM_XRAM_ALLOCATED, RAM_XRAM_ALLOCATED);
+	memcpy(xram2, in + 1536 + 2*RAM_XRAM_ALLOCATED, RAM_XRAM_ALLOCATED);
+
+	const byte *extra = in + 1536 + 3*RAM_XRAM_ALLOCATED;
+	T1LC_Temp = extra[0];
+	T1HC_Temp = extra[1];
+	T1RL_data = extra[2];
+	T1RH_data = extra[3];
+
+	updateBanks();
+	displayGeneration++;
+}
+
@@ -62,6 +62,7 @@
 #define P3 0x14c
 #define P3DDR 0x14d
 #define P3INT 0x14e
+#define FPR 0x154
 #define P7 0x15c
 #define I01CR 0x15d
 #define I23CR 0x15e
@@ -73,6 +74,47 @@
 #define BTCR 0x17f
 #define XRAM 0x180
 
+class VE_VMS_SCHEDULER;
+
+//Size of 9-bit direct address space (Main RAM, SFR and XRAM)
+#define RAM_DIRECT_SIZE 0x200
+
+//Direct space is mapped to host memory in pages
+#define RAM_PAGE_SIZE 0x80
+#define RAM_PAGE_COUNT (RAM_DIRECT_SIZE / RAM_PAGE_SIZE)
+
+//How an address of the direct space is accessed (Low bits of access table entries)
+#define RAM_ACCESS_PLAIN 0      //Stored as is
+#define RAM_ACCESS_MAIN 1       //Main RAM, bank selected by PSW bit 1
+#define RAM_ACCESS_XRAM 2       //XRAM window, bank selected by XBNK
+#define RAM_ACCESS_PSW 3        //May have pending ALU flags
+#define RAM_ACCESS_BANK 4       //EXT, FPR, XBNK and STAD select memory banks
+#define RAM_ACCESS_TIMER 5      //Timers are synced around access
+#define RAM_ACCESS_T1RELOAD 6   //T1LR and T1HR, timer SFR whose reads see the reload registers
+#define RAM_ACCESS_T1COMPARE 7  //T1LC and T1HC, writes go to latches
+#define RAM_ACCESS_VTRBF 8      //Work RAM at VRMAD
+#define RAM_ACCESS_DISPLAY 9    //MCR and VCCR, change what LCD shows
+#define RAM_ACCESS_KIND 0x0F
+
+#define RAM_ACCESS_OBSERVED 0x80    //Observer is notified after a write
+
+//Notified after software writes an address it observes
+class VE_VMS_SFR_OBSERVER
+{
+public:
+    virtual ~VE_VMS_SFR_OBSERVER() {}
+
+    virtual void sfrWritten(size_t address, byte value) = 0;
+};
+
+//XRAM banks hold 0x7C bytes, but STAD moves the window at 0x180 up to 255 bytes into a bank,
+//so each bank has room for the furthest window (Bytes past 0x7C are kept like the rest of the bank)
+#define RAM_XRAM_SIZE 0x7C
+#define RAM_XRAM_ALLOCATED (RAM_XRAM_SIZE + 0xFF)
+
+//Size of a RAM snapshot (Main RAM and SFR, work RAM, 3 XRAM banks and T1 latches)
+#define RAM_STATE_SIZE (1024 + 512 + 3*RAM_XRAM_ALLOCATED + 4)
+
 class VE_VMS_RAM
 {
 public:
@@ -85,6 +127,27 @@ public:
     byte T1RL_data;
     byte T1RH_data;
 
+    //Lazy ALU flags: While flagTable is set, CY, AC and OV of PSW are flagTable[flagIndex] (ALU layout)
+    const byte *flagTable;
+    uint32_t flagIndex;
+
+    //Memory banks, follow writes to EXT (Code in ROM or flash) and FPR (Flash bank and write protection)
+    const byte *codeBank;
+    size_t flashBank;   //Offset of selected flash bank (0 or 0x10000)
+    bool flashWriteProtected;
+
+    //Host memory of each page of direct space, main RAM follows PSW bit 1 and XRAM window follows XBNK and STAD
+    byte *pages[RAM_PAGE_COUNT];
+
+    //Indirection registers (@R0-@R3) of bank selected by IRBK0 and IRBK1 in PSW
+    const byte *indirectRegisters;
+
+    //Bumped by every write that may change what LCD shows (XRAM, MCR, VCCR and STAD), video redraws only when it changed
+    unsigned displayGeneration;
+
+    //Timers are advanced lazily, software access to their SFRs syncs them first
+    VE_VMS_SCHEDULER *scheduler;
+
 
     VE_VMS_RAM();
     ~VE_VMS_RAM();
@@ -108,6 +171,39 @@ public:
     byte stackPop();
 
     byte *getData();
+
+    //Work RAM (512 bytes) and XRAM banks (0x7C bytes each, bank 0-2)
+    byte *getWRAM();
+
+    byte *getXRAM(int bank);
+
+    //Writes pending ALU flags into PSW
+    void syncFlags();
+
+    //Sets ROM and flash images that EXT selects code from
+    void setCodeMemory(const byte *rom, const byte *flash);
+
+    //Recomputes bank state from EXT, FPR, PSW, XBNK and STAD
+    void updateBanks();
+
+    //SFRs that timers read or write
+    static bool isTimerSFR(size_t address);
+
+    //Observer is called after software writes address (0x000-0x1FF, main RAM bank 0 and SFR, not XRAM), NULL removes it
+    void setObserver(size_t address, VE_VMS_SFR_OBSERVER *observer);
+
+    bool isObserved(size_t address);
+
+    //Whether a write to address is a plain store (No side effects or observer)
+    bool isPlainWrite(size_t address);
+
+    //Notifies observers of addresses in a range written without writeByte
+    void notifyObservers(size_t address, size_t count);
+
+    //Copies whole RAM (Including work RAM and XRAM) to/from a buffer of RAM_STATE_SIZE bytes
+    void saveState(byte *out);
+
+    void loadState(const byte *in);
     
 private:
     byte *data;
@@ -115,6 +211,39 @@ private:
     byte *xram0;
     byte *xram1;
     byte *xram2;
+
+    const byte *romMemory;
+    const byte *flashMemory;
+
+    //RAM_ACCESS_* of each address, plain RAM needs no more than an indexed store
+    byte access[RAM_DIRECT_SIZE];
+    VE_VMS_SFR_OBSERVER *observers[RAM_DIRECT_SIZE];
+
+    //Work RAM address VTRBF accesses
+    size_t nextVRMAD();
+
+    //Side effects of an observed address run once it is written
+    void notifyObserver(size_t address, byte b);
 };
 
+inline bool VE_VMS_RAM::isTimerSFR(size_t address)
+{
+    return (address >= T0CNT && address <= T0HR) || address == T1CNT || address == T1LR || address == T1HR || address == BTCR;
+}
+
+inline bool VE_VMS_RAM::isObserved(size_t address)
+{
+    return address < RAM_DIRECT_SIZE && observers[address] != NULL;
+}
+
+inline bool VE_VMS_RAM::isPlainWrite(size_t address)
+{
+    return address < RAM_DIRECT_SIZE && (access[address] == RAM_ACCESS_PLAIN || access[address] == RAM_ACCESS_MAIN);
+}
+
+inline void VE_VMS_RAM::notifyObserver(size_t address, byte b)
+{
+    if(address < RAM_DIRECT_SIZE && observers[address] != NULL) observers[address]->sfrWritten(address, b & 0xFF);
+}
+
 #endif // _RAM_H_
@@ -16,45 +16,166 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <string.h>
+#include <vector>
 #include "rom.h"
 
-VE_VMS_ROM::VE_VMS_ROM()
+//Instances may be created and destroyed on different threads
+#if defined(__unix__) || defined(__APPLE__)
+#define VE_VMS_ROM_LOCK
+#include <pthread.h>
+#endif
+
+//Interned images, one per distinct content
+static std::vector<VE_VMS_ROM_IMAGE *> images;
+
+#ifdef VE_VMS_ROM_LOCK
+//Guards images and every image's references
+static pthread_mutex_t imagesLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static void lockImages()
+{
+#ifdef VE_VMS_ROM_LOCK
+	pthread_mutex_lock(&imagesLock);
+#endif
+}
+
+static void unlockImages()
 {
-	data = new size_t[0x100000];
+#ifdef VE_VMS_ROM_LOCK
+	pthread_mutex_unlock(&imagesLock);
+#endif
+}
+
+//Used until an image is loaded (No BIOS)
+static byte emptyImage[ROM_SIZE];
+
+VE_VMS_ROM::VE_VMS_ROM(VE_VMS_ICACHE *_icache)
+{
+	data = emptyImage;
+	image = NULL;
+	privateData = NULL;
+
+	icache = _icache;
 }
 
 VE_VMS_ROM::~VE_VMS_ROM()
 {
-	delete []data;
+	release();
+}
+
+///Returns shared image with the same content as d (Zero padded to ROM_SIZE), creating it if needed
+VE_VMS_ROM_IMAGE *VE_VMS_ROM::intern(const byte *d, size_t size)
+{
+	if(size > ROM_SIZE) size = ROM_SIZE;
+
+	lockImages();
+
+	for(size_t i = 0; i < images.size(); ++i)
+	{
+		const byte *imageData = images[i]->data;
+
+		if(memcmp(imageData, d, size) != 0) continue;
+
+		bool padded = true;
+		for(size_t j = size; j < ROM_SIZE && padded; ++j)
+			padded = imageData[j] == 0;
+
+		if(padded)
+		{
+			VE_VMS_ROM_IMAGE *found = images[i];
+			found->references++;
+
+			unlockImages();
+			return found;
+		}
+	}
+
+	VE_VMS_ROM_IMAGE *newImage = new VE_VMS_ROM_IMAGE;
+	memcpy(newImage->data, d, size);
+	memset(newImage->data + size, 0, ROM_SIZE - size);
+	newImage->references = 1;
+	images.push_back(newImage);
+
+	unlockImages();
+	return newImage;
+}
+
+//Drops current image, ROM reads as 0 afterwards
+void VE_VMS_ROM::release()
+{
+	bool unused = false;
+
+	if(image != NULL)
+	{
+		lockImages();
+
+		unused = --image->references == 0;
+		for(size_t i = 0; i < images.size() && unused; ++i)
+		{
+			if(images[i] == image)
+			{
+				images.erase(images.begin() + i);
+				break;
+			}
+		}
+
+		unlockImages();
+	}
+
+	if(unused) delete image;
+
+	delete []privateData;
+
+	image = NULL;
+	privateData = NULL;
+	data = emptyImage;
 }
 
 //Setters and getters
 byte VE_VMS_ROM::readByte(size_t address)
 {
-	return data[address] & 0xFF;
+	return data[address & 0xFFFF];
 }
 
 void VE_VMS_ROM::writeByte(size_t address, byte b)
 {
-	data[address] = b & 0xFF;
+	if(privateData == NULL)
+	{
+		byte *copy = new byte[ROM_SIZE];
+		memcpy(copy, data, ROM_SIZE);
+
+		release();
+		privateData = copy;
+		data = privateData;
+	}
+
+	privateData[address & 0xFFFF] = b & 0xFF;
+
+	icache->invalidate(ICACHE_ROM, address);
 }
 
 //Memory operations
 void VE_VMS_ROM::loadData(byte *d, size_t buffSize, size_t size)
 {
 	if(buffSize < size) return;
-	for(size_t i = 0; i < size; i++)
-		data[i] = d[i];
+
+	loadData(d, size);
 }
 
 void VE_VMS_ROM::loadData(byte *d, size_t buffSize)
 {
-	for(size_t i = 0; i < buffSize; i++)
-		data[i] = d[i];
+	VE_VMS_ROM_IMAGE *newImage = intern(d, buffSize);
+
+	release();
+	image = newImage;
+	data = image->data;
+
+	icache->invalidateAll(ICACHE_ROM);
 }
 
-size_t *VE_VMS_ROM::getData()
+const byte *VE_VMS_ROM::getData()
 {
 	return data;
 }
-
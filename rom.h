@@ -20,16 +20,29 @@
 #define _ROM_H_
 
 #include "common.h"
+#include "icache.h"
+
+//ROM address space (BIOS is 0xF000 bytes, the rest reads as 0)
+#define ROM_SIZE 0x10000
+
+//Read-only ROM image, shared by every VE_VMS_ROM loaded with the same content
+//Images are looked up and released under a lock on unix, elsewhere load and unload instances on one thread
+struct VE_VMS_ROM_IMAGE
+{
+    byte data[ROM_SIZE];
+    int references;
+};
 
 class VE_VMS_ROM
 {
 public:
-    VE_VMS_ROM();
+    VE_VMS_ROM(VE_VMS_ICACHE *_icache);
     ~VE_VMS_ROM();
 
     //Setters and getters
     byte readByte(size_t address);
 
+    //Copies shared image first, so other instances are not affected
     void writeByte(size_t address, byte b);
 
     //Memory operations
@@ -37,10 +50,20 @@ public:
 
     void loadData(byte *d, size_t buffSize);
 
-    size_t *getData();
+    //Current image (Changes after loadData or writeByte)
+    const byte *getData();
 
 private:
-	size_t *data;
+	const byte *data;
+
+	VE_VMS_ROM_IMAGE *image;    //Shared image in use, NULL if none
+	byte *privateData;          //Own copy after a write, NULL if none
+
+	VE_VMS_ICACHE *icache;
+
+	void release();
+
+	static VE_VMS_ROM_IMAGE *intern(const byte *d, size_t size);
 };
 
 #endif // _ROM_H_
@@ -0,0 +1,119 @@
+/*
+    VeMUlator - A Dreamcast Visual Memory Unit emulator for libretro
+    Copyright (C) 2018  Mahmoud Jaoune
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "scheduler.h"
+
+VE_VMS_SCHEDULER::VE_VMS_SCHEDULER(VE_VMS_TIMER0 *_t0, VE_VMS_TIMER1 *_t1, VE_VMS_BASETIMER *_baseTimer)
+{
+	t0 = _t0;
+	t1 = _t1;
+	baseTimer = _baseTimer;
+
+	now = 0;
+	synced = 0;
+
+	for(int i = 0; i < SCHED_COUNT; ++i)
+		events[i] = CYCLES_NEVER;
+
+	next = CYCLES_NEVER;
+}
+
+VE_VMS_SCHEDULER::~VE_VMS_SCHEDULER()
+{
+}
+
+///Moves cycle numbers to start of frame, timer events are recomputed since their SFRs may have been written directly.
+///Last instruction of previous frame may have ended after it, so the new one starts that many cycles in.
+void VE_VMS_SCHEDULER::beginFrame(int cycles)
+{
+	int elapsed = (now > events[SCHED_FRAME]) ? events[SCHED_FRAME] : now;
+
+	for(int i = 0; i < SCHED_COUNT; ++i)
+		if(events[i] != CYCLES_NEVER) events[i] -= elapsed;
+
+	synced -= elapsed;
+	now -= elapsed;
+
+	events[SCHED_FRAME] = cycles;
+	reschedule();
+}
+
+void VE_VMS_SCHEDULER::schedule(int source, int cycle)
+{
+	events[source] = cycle;
+	updateNext();
+}
+
+///Runs timers for all cycles since the last sync, interrupts they raise are due now at the latest
+void VE_VMS_SCHEDULER::sync()
+{
+	int cycles = now - synced;
+	if(cycles <= 0) return;
+
+	t0->advance(cycles);
+	t1->advance(cycles);
+	baseTimer->advance(cycles);
+
+	synced = now;
+}
+
+///Timer events are counted from the cycle they were synced to
+void VE_VMS_SCHEDULER::reschedule()
+{
+	int cycles = t0->cyclesUntilNextEvent();
+	events[SCHED_T0] = (cycles == CYCLES_NEVER) ? CYCLES_NEVER : synced + cycles;
+
+	cycles = baseTimer->cyclesUntilNextEvent();
+	events[SCHED_BASETIMER] = (cycles == CYCLES_NEVER) ? CYCLES_NEVER : synced + cycles;
+
+	updateNext();
+}
+
+void VE_VMS_SCHEDULER::updateNext()
+{
+	next = events[0];
+
+	for(int i = 1; i < SCHED_COUNT; ++i)
+		if(events[i] < next) next = events[i];
+}
+
+///Software last read timers when they were synced, so what it read stays valid until then
+int VE_VMS_SCHEDULER::nextChange(size_t address)
+{
+	int cycles;
+
+	switch(address)
+	{
+		case T0CNT:
+		case T0L:
+		case T0H:
+			cycles = t0->cyclesUntilChange();
+			break;
+		case T1LR:
+		case T1HR:
+			cycles = t1->cyclesUntilChange();
+			break;
+		case BTCR:
+			cycles = baseTimer->cyclesUntilChange();
+			break;
+		default:
+			return CYCLES_NEVER;
+	}
+
+	return (cycles == CYCLES_NEVER) ? CYCLES_NEVER : synced + cycles;
+}
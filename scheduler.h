@@ -0,0 +1,86 @@
+/*
+    VeMUlator - A Dreamcast Visual Memory Unit emulator for libretro
+    Copyright (C) 2018  Mahmoud Jaoune
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+#include "common.h"
+#include "t0.h"
+#include "t1.h"
+#include "basetimer.h"
+
+//Event sources, also slot number in event queue
+#define SCHED_T0 0
+#define SCHED_BASETIMER 1
+#define SCHED_RTC 2
+#define SCHED_FRAME 3
+#define SCHED_COUNT 4
+
+//Keeps the next event of each source, timers are only advanced at events or when software accesses their SFRs
+class VE_VMS_SCHEDULER
+{
+public:
+    //Cycle numbers are counted from start of current frame
+    int now;
+    int next;   //Earliest event
+
+    VE_VMS_SCHEDULER(VE_VMS_TIMER0 *_t0, VE_VMS_TIMER1 *_t1, VE_VMS_BASETIMER *_baseTimer);
+    ~VE_VMS_SCHEDULER();
+
+    //Starts a frame that ends after a number of cycles
+    void beginFrame(int cycles);
+
+    //Sets event of source at cycle (Or CYCLES_NEVER)
+    void schedule(int source, int cycle);
+
+    bool due(int source);
+
+    int getEvent(int source);
+
+    //Advances timers up to now
+    void sync();
+
+    //Timer state changed, their events are computed again
+    void reschedule();
+
+    //Cycle when a timer may change what software reads at address (Counted from last sync, like events),
+    //CYCLES_NEVER if only software changes it
+    int nextChange(size_t address);
+
+private:
+    int synced;     //Timers have run all cycles before this one
+    int events[SCHED_COUNT];
+
+    VE_VMS_TIMER0 *t0;
+    VE_VMS_TIMER1 *t1;
+    VE_VMS_BASETIMER *baseTimer;
+
+    void updateNext();
+};
+
+inline bool VE_VMS_SCHEDULER::due(int source)
+{
+    return events[source] <= now;
+}
+
+inline int VE_VMS_SCHEDULER::getEvent(int source)
+{
+    return events[source];
+}
+
+#endif // _SCHEDULER_H_
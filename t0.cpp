@@ -18,12 +18,15 @@
 
 #include "t0.h"
 
-VE_VMS_TIMER0::VE_VMS_TIMER0(VE_VMS_RAM *_ram, VE_VMS_INTERRUPTS *_intHandler, VE_VMS_CPU *_cpu, byte *_prescaler)
+VE_VMS_TIMER0::VE_VMS_TIMER0(VE_VMS_RAM *_ram, VE_VMS_INTERRUPTS *_intHandler, VE_VMS_CPU *_cpu)
 {
 	ram = _ram;
 	intHandler = _intHandler;
 	cpu = _cpu;
-	prescaler = _prescaler;
+	
+	prescaler = 0;
+	pcount = 0;
+	oldPRR = -1;
 	
 	TRLStarted = 0;
     TRHStarted = 0;
@@ -37,8 +40,31 @@ VE_VMS_TIMER0::~VE_VMS_TIMER0()
 	
 }
 
+void VE_VMS_TIMER0::runPrescaler()
+{
+	byte PRR = ram->readByte_RAW(T0PRR);
+
+	//This is important since Base Timer interrupts sometimes manipulates PRR, so we reset it so the modulo would be 0 in case number came.
+	if (PRR != oldPRR) 
+		pcount = PRR;
+		
+	if (pcount / 256 == 1) 
+	{
+		prescaler = 1;
+		pcount = PRR;
+	} 
+	else 
+	{
+		prescaler = 0;
+		pcount++;
+	}
+	oldPRR = PRR;
+}
+
 void VE_VMS_TIMER0::runTimer() 
 {
+	runPrescaler();
+
 	int TCNT_data = ram->readByte_RAW(T0CNT); //Timer control register
 
 	bool TRLEnabled;
@@ -61,7 +87,7 @@ void VE_VMS_TIMER0::runTimer()
 			TRL_data = ram->readByte_RAW(T0LR);
 			//printf("Started T0RL\n");
 		}
-		else if(*prescaler == 1) TRL_data++;
+		else if(prescaler == 1) TRL_data++;
 	} 
 	else 
 	{
@@ -78,7 +104,7 @@ void VE_VMS_TIMER0::runTimer()
 		}
 		else if(!TRLONGEnabled)
 		{
-			if(*prescaler == 1)
+			if(prescaler == 1)
 				TRH_data++;
 		}
 		
@@ -154,3 +180,217 @@ void VE_VMS_TIMER0::runTimer()
 	ram->writeByte_RAW(T0CNT, TCNT_data);
 }
     
+
+///Runs timer for n cycles. Counters only change when the prescaler wraps, so runs of cycles are done at once,
+///only cycles that restart the prescaler, load a counter or stop TRH (8-bit overflow) are run one by one.
+void VE_VMS_TIMER0::advance(int n)
+{
+	while(n > 0)
+	{
+		int TCNT_data = ram->readByte_RAW(T0CNT);
+		bool TRLEnabled = (TCNT_data & 64) != 0;
+		bool TRHEnabled = (TCNT_data & 128) != 0;
+		bool TRLONGEnabled = (TCNT_data & 32) != 0;
+		int PRR = ram->readByte_RAW(T0PRR);
+
+		if(PRR != oldPRR || (TRLEnabled && TRLStarted == 0) || (TRHEnabled && TRHStarted == 0))
+		{
+			runTimer();
+			n--;
+			continue;
+		}
+
+		int cycles = n;
+
+		if(TRHEnabled && !TRLONGEnabled)
+		{
+			//Cycle of the wrap that takes TRH to 256
+			int overflowCycle = (257 - pcount) + (255 - (int)TRH_data) * (257 - PRR);
+
+			if(overflowCycle == 1)
+			{
+				runTimer();
+				n--;
+				continue;
+			}
+
+			if(overflowCycle <= cycles) cycles = overflowCycle - 1;
+		}
+
+		count(cycles);
+		n -= cycles;
+	}
+}
+
+///Runs cycles that neither restart the prescaler, load a counter nor stop TRH
+void VE_VMS_TIMER0::count(int cycles)
+{
+	int TCNT_data = ram->readByte_RAW(T0CNT);
+	bool TRLEnabled = (TCNT_data & 64) != 0;
+	bool TRHEnabled = (TCNT_data & 128) != 0;
+	bool TRLONGEnabled = (TCNT_data & 32) != 0;
+	int PRR = ram->readByte_RAW(T0PRR);
+	int LR = ram->readByte_RAW(T0LR);
+	int HR = ram->readByte_RAW(T0HR);
+
+	//Prescaler wraps in the cycle it reaches 256 (Restarting at PRR)
+	int period = 257 - PRR;
+	int firstWrap = 257 - pcount;
+	int wraps = 0;
+	bool lastWraps = false;     //Last cycle is a wrap
+
+	if(cycles >= firstWrap)
+	{
+		wraps = 1 + (cycles - firstWrap) / period;
+		pcount = PRR + (cycles - firstWrap) % period;
+		lastWraps = pcount == PRR;
+	}
+	else pcount += cycles;
+
+	prescaler = lastWraps ? 1 : 0;
+
+	//TRL overflows after reaching 256, then counts again from T0LR
+	int low = (int)TRL_data;
+	int TRLOverflows = 0;
+	bool lastTRLOverflows = false;
+
+	if(!TRLEnabled)
+	{
+		low = LR;
+		TRLStarted = 0;
+	}
+	else if(wraps >= 256 - low)
+	{
+		int left = wraps - (256 - low);
+
+		TRLOverflows = 1 + left / (256 - LR);
+		low = LR + left % (256 - LR);
+		lastTRLOverflows = lastWraps && low == LR;
+	}
+	else low += wraps;
+
+	int high = (int)TRH_data;
+
+	if(!TRLONGEnabled)
+	{
+		if(TRLOverflows > 0)
+		{
+			TCNT_data |= 2;
+			if (TCNT_data & 1) intHandler->setINT2();
+		}
+
+		//TRH can't overflow here
+		if(TRHEnabled) high += wraps;
+		else
+		{
+			high = HR;
+			TRHStarted = 0;
+		}
+	}
+	else
+	{
+		if(TRLOverflows > 0 && (TCNT_data & 1)) intHandler->setINT2();
+
+		int TRHOverflows = 0;
+
+		if(TRHEnabled)
+		{
+			//TRH counts TRL overflows, then both are reloaded
+			if(TRLOverflows >= 256 - high)
+			{
+				int left = TRLOverflows - (256 - high);
+
+				TRHOverflows = 1;
+				high = HR + left % (256 - HR);
+			}
+			else high += TRLOverflows;
+		}
+		else
+		{
+			//TRH is reloaded each cycle, TRL overflow increments it in the same cycle
+			TRHStarted = 0;
+			high = HR;
+
+			if(TRLOverflows > 0 && HR == 255) TRHOverflows = 1;
+			else if(lastTRLOverflows) high = HR + 1;
+		}
+
+		if(TRHOverflows > 0)
+		{
+			TCNT_data |= 2;
+			TCNT_data |= 8;
+
+			if (TCNT_data & 4) intHandler->setT0HOV();
+		}
+	}
+
+	TRL_data = low;
+	TRH_data = high;
+
+	ram->writeByte_RAW(T0L, TRL_data);
+	ram->writeByte_RAW(T0H, TRH_data);
+	ram->writeByte_RAW(T0CNT, TCNT_data);
+}
+
+///Interrupts are only raised on overflows, so this is the first overflow that has its interrupt enabled
+int VE_VMS_TIMER0::cyclesUntilNextEvent()
+{
+	int TCNT_data = ram->readByte_RAW(T0CNT);
+	bool TRLEnabled = (TCNT_data & 64) != 0;
+	bool TRHEnabled = (TCNT_data & 128) != 0;
+	bool TRLONGEnabled = (TCNT_data & 32) != 0;
+
+	int cycles = CYCLES_NEVER;
+
+	if(TRLONGEnabled)
+	{
+		//TRH only counts TRL overflows, both interrupts come with one
+		if(TRLEnabled && (TCNT_data & 5) != 0) cycles = cyclesUntilOverflow(TRL_data, TRLStarted);
+	}
+	else
+	{
+		if(TRLEnabled && (TCNT_data & 1) != 0) cycles = cyclesUntilOverflow(TRL_data, TRLStarted);
+		if(TRHEnabled && (TCNT_data & 4) != 0)
+		{
+			int TRHCycles = cyclesUntilOverflow(TRH_data, TRHStarted);
+			if(TRHCycles < cycles) cycles = TRHCycles;
+		}
+	}
+
+	return cycles;
+}
+
+int VE_VMS_TIMER0::cyclesUntilOverflow(double counter, int started)
+{
+	//Counter is loaded on its first cycle
+	if(started == 0) return 1;
+
+	//Prescaler wraps in the cycle it reaches 256 (Restarting at PRR)
+	int PRR = ram->readByte_RAW(T0PRR);
+	int count = (PRR != oldPRR) ? PRR : pcount;
+	int firstWrap = 257 - count;
+	int increments = 256 - (int)counter;
+
+	return firstWrap + (increments - 1) * (257 - PRR);
+}
+
+///Counters are written back every cycle (Stopped ones from their reload registers), started ones only count when the prescaler wraps
+int VE_VMS_TIMER0::cyclesUntilChange()
+{
+	int TCNT_data = ram->readByte_RAW(T0CNT);
+	bool TRLEnabled = (TCNT_data & 64) != 0;
+	bool TRHEnabled = (TCNT_data & 128) != 0;
+
+	//Software wrote a counter or a reload register since last cycle
+	byte low = TRLEnabled ? (byte)TRL_data : ram->readByte_RAW(T0LR);
+	byte high = TRHEnabled ? (byte)TRH_data : ram->readByte_RAW(T0HR);
+	if(ram->readByte_RAW(T0L) != low || ram->readByte_RAW(T0H) != high) return 1;
+
+	if(!TRLEnabled && !TRHEnabled) return CYCLES_NEVER;
+
+	//Counter is loaded on its first cycle
+	if((TRLEnabled && TRLStarted == 0) || (TRHEnabled && TRHStarted == 0)) return 1;
+
+	//Counting and overflow flags happen on the next wrap
+	return cyclesUntilOverflow(255, 1);
+}
@@ -26,21 +26,44 @@
 class VE_VMS_TIMER0
 {
 public:
-    VE_VMS_TIMER0(VE_VMS_RAM *_ram, VE_VMS_INTERRUPTS *_intHandler, VE_VMS_CPU *_cpu, byte *_prescaler);
+    VE_VMS_TIMER0(VE_VMS_RAM *_ram, VE_VMS_INTERRUPTS *_intHandler, VE_VMS_CPU *_cpu);
     ~VE_VMS_TIMER0();
-
+    
+    //Runs timer (And its prescaler) for one cycle
     void runTimer();
+
+    //Runs timer for n cycles
+    void advance(int n);
+
+    //Cycles until timer may raise an interrupt (At least 1), CYCLES_NEVER if it cannot
+    int cyclesUntilNextEvent();
+
+    //Cycles until software may read something else from T0L, T0H or T0CNT, CYCLES_NEVER if only software changes them
+    int cyclesUntilChange();
     
 private:
 	int TRLStarted;
     int TRHStarted;
+    
     VE_VMS_RAM *ram;
     VE_VMS_INTERRUPTS *intHandler;
     VE_VMS_CPU *cpu;
-    byte *prescaler;
     
     double TRL_data;
 	double TRH_data;
+
+    //Prescaler counts from T0PRR to 256, timer counts once each time it wraps
+    byte prescaler;
+    int pcount;
+    int oldPRR;
+
+    void runPrescaler();
+
+    //Runs cycles that only count
+    void count(int cycles);
+
+    //Cycles until a counter overflows, started counters count once per prescaler wrap
+    int cyclesUntilOverflow(double counter, int started);
 };
 
 #endif // _T0_H_
@@ -137,3 +137,61 @@ void VE_VMS_TIMER1::runTimer()
 	//ram->writeByte_RAW(ram->T1HR, ram->T1RH_data);
 	ram->writeByte_RAW(T1CNT, TCNT_data);
 }
+
+///Runs timer for n cycles. Counters wrap at 8 bits without overflowing, so only the cycle that loads TRL
+///(It is passed to audio) is run on its own.
+void VE_VMS_TIMER1::advance(int n)
+{
+	if(n <= 0) return;
+
+	int TCNT_data = ram->readByte_RAW(T1CNT);
+	bool TRLEnabled = (TCNT_data & 64) != 0;
+	bool TRHEnabled = (TCNT_data & 128) != 0;
+	bool TRLONGEnabled = (TCNT_data & 32) != 0;
+
+	if(TRLEnabled && TRLStarted == 0)
+	{
+		runTimer();
+		if(--n == 0) return;
+	}
+
+	if(TRLEnabled)
+	{
+		//Tcyc/2 counts twice per cycle
+		int step = (TRLONGEnabled && !TRHEnabled) ? 2 : 1;
+		ram->T1RL_data = (ram->T1RL_data + (n & 0xFF) * step) & 0xFF;
+	}
+	else
+	{
+		ram->T1RL_data = ram->readByte_RAW(T1LR);
+		TRLStarted = 0;
+	}
+
+	audio->setEnabled(TRLEnabled & !TRLONGEnabled);
+
+	if(TRHEnabled) 
+	{
+		TRHStarted = 1;
+		if(!TRLONGEnabled) ram->T1RH_data = (ram->T1RH_data + (n & 0xFF)) & 0xFF;
+	} 
+	else 
+	{
+		ram->T1RH_data = ram->readByte_RAW(T1HR);
+		TRHStarted = 0;
+	}
+}
+
+int VE_VMS_TIMER1::cyclesUntilNextEvent()
+{
+	return CYCLES_NEVER;
+}
+
+///Running counters change every cycle, stopped ones follow their reload registers
+int VE_VMS_TIMER1::cyclesUntilChange()
+{
+	if((ram->readByte_RAW(T1CNT) & 0xC0) != 0) return 1;
+
+	if(ram->T1RL_data != ram->readByte_RAW(T1LR) || ram->T1RH_data != ram->readByte_RAW(T1HR)) return 1;
+
+	return CYCLES_NEVER;
+}
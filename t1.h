@@ -30,6 +30,15 @@ public:
     ~VE_VMS_TIMER1();
 
     void runTimer();
+
+    //Runs timer for n cycles
+    void advance(int n);
+
+    //Cycles until timer may raise an interrupt, counters wrap before reaching the overflow checks so it never does
+    int cyclesUntilNextEvent();
+
+    //Cycles until software may read something else from T1LR or T1HR, CYCLES_NEVER if only software changes them
+    int cyclesUntilChange();
     
 private:
     int TRLStarted;
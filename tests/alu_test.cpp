@@ -0,0 +1,61 @@
+/*
+    VeMUlator - A Dreamcast Visual Memory Unit emulator for libretro
+    Copyright (C) 2018  Mahmoud Jaoune
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+//Checks ALU flag tables against add8/sub8 for every (carry, op1, op2)
+
+#include <stdio.h>
+#include "alu.h"
+#include "bitwisemath.h"
+
+int main()
+{
+	ALU_init();
+
+	int failures = 0;
+	byte expected[2];
+
+	for(int carry = 0; carry < 2; ++carry)
+	{
+		for(int op1 = 0; op1 < 256; ++op1)
+		{
+			for(int op2 = 0; op2 < 256; ++op2)
+			{
+				VE_VMS_ALU_RESULT r = ALU_add(op1, op2, carry);
+				add8(op1, op2, carry, expected);
+
+				if(r.value != expected[0] || r.flags != expected[1])
+				{
+					if(failures++ < 10) printf("add %02X + %02X + %d: got %02X/%X, add8 %02X/%X\n", op1, op2, carry, r.value, r.flags, expected[0], expected[1]);
+				}
+
+				r = ALU_sub(op1, op2, carry);
+				sub8(op1, op2, carry, expected);
+
+				if(r.value != expected[0] || r.flags != expected[1])
+				{
+					if(failures++ < 10) printf("sub %02X - %02X - %d: got %02X/%X, sub8 %02X/%X\n", op1, op2, carry, r.value, r.flags, expected[0], expected[1]);
+				}
+			}
+		}
+	}
+
+	printf("alu_test: %d mismatches in %d inputs\n", failures, 2 * 0x20000);
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,283 @@
+/*
+    VeMUlator - A Dreamcast Visual Memory Unit emulator for libretro
+    Copyright (C) 2018  Mahmoud Jaoune
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+
+//Checks drawn frames: every format, scale, effect and palette is drawn into a buffer of exact size (Then with
+//padding after each line), with the window at STAD 0 and 2 and by one or all threads. Guard bytes around the frame
+//must stay untouched, and every pixel must match a reference built bit by bit from XRAM and the expected cell.
+//Also built with VE_VMS_VIDEO_NO_SSE2, which checks lines expanded by lookup table.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "video.h"
+
+#define GUARD_BYTES 64
+#define GUARD 0xA5
+
+static const char *effectNames[] = {"none", "grid", "dots"};
+
+//On, off and grid color of each palette (0xRRGGBB)
+static const uint32_t palettes[VIDEO_PALETTE_COUNT][3] =
+{
+	{0x000000, 0xFFFFFF, 0xD8D8D8},
+	{0x1E2A1A, 0x9DB68A, 0x8CA37A},
+	{0x3C1E00, 0xF0A830, 0xD8942A},
+	{0xF0F8FF, 0x2050B0, 0x18409A}
+};
+
+//Cells drawn for a pixel, rows from top ('o' takes pixel color, '#' grid color)
+struct CELL_PATTERN
+{
+	int effect;
+	int scale;
+	const char *rows[VIDEO_MAX_SCALE];
+};
+
+static const CELL_PATTERN cellPatterns[] =
+{
+	{VIDEO_EFFECT_GRID, 2, {"o#", "##"}},
+	{VIDEO_EFFECT_DOTS, 2, {"o#", "##"}},
+	{VIDEO_EFFECT_DOTS, 3, {"oo#", "oo#", "###"}},
+	{VIDEO_EFFECT_GRID, 4, {"ooo#", "ooo#", "ooo#", "####"}},
+	{VIDEO_EFFECT_DOTS, 4, {"#o##", "ooo#", "#o##", "####"}},
+	{VIDEO_EFFECT_GRID, 10, {"ooooooooo#", "ooooooooo#", "ooooooooo#", "ooooooooo#", "ooooooooo#",
+		"ooooooooo#", "ooooooooo#", "ooooooooo#", "ooooooooo#", "##########"}},
+	{VIDEO_EFFECT_DOTS, 10, {"#ooooooo##", "ooooooooo#", "ooooooooo#", "ooooooooo#", "ooooooooo#",
+		"ooooooooo#", "ooooooooo#", "ooooooooo#", "#ooooooo##", "##########"}}
+};
+
+//Cell at scale: a pattern above, otherwise grid takes last row and column (Scale 2 and up) and dots also cut
+//corners of what is left (Scale 4 and up)
+static void buildCell(int effect, int scale, char cell[VIDEO_MAX_SCALE][VIDEO_MAX_SCALE + 1])
+{
+	for(size_t i = 0; i < sizeof(cellPatterns) / sizeof(cellPatterns[0]); ++i)
+	{
+		if(cellPatterns[i].effect != effect || cellPatterns[i].scale != scale) continue;
+
+		for(int k = 0; k < scale; ++k)
+			strcpy(cell[k], cellPatterns[i].rows[k]);
+		return;
+	}
+
+	for(int k = 0; k < scale; ++k)
+	{
+		for(int j = 0; j < scale; ++j)
+		{
+			bool grid = effect != VIDEO_EFFECT_NONE && scale >= 2 && (k == scale - 1 || j == scale - 1);
+			bool corner = (k == 0 || k == scale - 2) && (j == 0 || j == scale - 2);
+			if(effect == VIDEO_EFFECT_DOTS && scale >= 4 && corner) grid = true;
+
+			cell[k][j] = grid ? '#' : 'o';
+		}
+
+		cell[k][scale] = 0;
+	}
+}
+
+//0xRRGGBB in format, each channel keeps its top bits
+static uint32_t referenceColor(int format, uint32_t rgb)
+{
+	uint32_t r = (rgb >> 16) & 0xFF;
+	uint32_t g = (rgb >> 8) & 0xFF;
+	uint32_t b = rgb & 0xFF;
+
+	switch(format)
+	{
+		case VIDEO_FORMAT_0RGB1555:
+			return (r >> 3) << 10 | (g >> 3) << 5 | (b >> 3);
+		case VIDEO_FORMAT_XRGB8888:
+			return r << 16 | g << 8 | b;
+		default:
+			return (r >> 3) << 11 | (g >> 2) << 5 | (b >> 3);
+	}
+}
+
+//LCD pixels: lines are 6 bytes (MSB is leftmost pixel), two in each 16 bytes of XRAM from STAD, lines 16-31 are in bank 1
+static bool lit[SCREEN_HEIGHT][SCREEN_WIDTH];
+
+static void readLCD(VE_VMS_RAM *ram)
+{
+	for(int y = 0; y < SCREEN_HEIGHT; ++y)
+	{
+		const byte *bank = ram->getXRAM(y / 16) + ram->readByte_RAW(STAD);
+		const byte *line = bank + (y % 16 / 2) * 16 + (y % 2) * 6;
+
+		for(int x = 0; x < SCREEN_WIDTH; ++x)
+			lit[y][x] = ((line[x / 8] << (x % 8)) & 0x80) != 0;
+	}
+}
+
+static uint32_t readPixel(const byte *p, size_t size)
+{
+	if(size == 4)
+	{
+		uint32_t pixel;
+		memcpy(&pixel, p, 4);
+		return pixel;
+	}
+
+	uint16_t pixel;
+	memcpy(&pixel, p, 2);
+	return pixel;
+}
+
+//Draws a frame (Lines are padding bytes apart), returns number of failed checks
+static int checkFrame(VE_VMS_VIDEO *video, VE_VMS_RAM *ram, size_t padding)
+{
+	const VE_VMS_VIDEO_OPTIONS &options = video->getOptions();
+	size_t size = video->getPixelSize();
+	size_t rowBytes = video->getWidth() * size;
+	size_t pitch = rowBytes + padding;
+	size_t frameBytes = pitch * video->getHeight();
+
+	byte *memory = (byte *)malloc(GUARD_BYTES + frameBytes + GUARD_BYTES);
+	memset(memory, GUARD, GUARD_BYTES + frameBytes + GUARD_BYTES);
+
+	video->drawFrame(memory + GUARD_BYTES, pitch);
+
+	const byte *frame = memory + GUARD_BYTES;
+	int written = 0;
+	int wrong = 0;
+	bool drawn = false;
+
+	for(size_t i = 0; i < rowBytes; ++i)
+		if(frame[i] != GUARD) drawn = true;
+
+	for(size_t i = 0; i < GUARD_BYTES; ++i)
+	{
+		if(memory[i] != GUARD) written++;
+		if(frame[frameBytes + i] != GUARD) written++;
+	}
+
+	for(unsigned y = 0; y < video->getHeight(); ++y)
+		for(size_t i = rowBytes; i < pitch; ++i)
+			if(frame[y * pitch + i] != GUARD) written++;
+
+	if(drawn)
+	{
+		readLCD(ram);
+
+		int s = options.scale;
+		uint32_t on = referenceColor(options.format, palettes[options.palette][0]);
+		uint32_t off = referenceColor(options.format, palettes[options.palette][1]);
+		uint32_t grid = referenceColor(options.format, palettes[options.palette][2]);
+
+		char cell[VIDEO_MAX_SCALE][VIDEO_MAX_SCALE + 1];
+		buildCell(options.effect, s, cell);
+
+		for(unsigned y = 0; y < video->getHeight(); ++y)
+		{
+			for(unsigned x = 0; x < video->getWidth(); ++x)
+			{
+				uint32_t expected = (cell[y % s][x % s] == '#') ? grid : (lit[y / s][x / s] ? on : off);
+				uint32_t pixel = readPixel(frame + y * pitch + x * size, size);
+
+				if(pixel != expected && wrong++ == 0)
+					printf("format %d, x%d, %s, palette %d, STAD %d: pixel %u,%u is %X, expected %X\n", options.format, s, effectNames[options.effect], options.palette, ram->readByte_RAW(STAD), x, y, pixel, expected);
+			}
+		}
+	}
+
+	free(memory);
+
+	int failures = 0;
+	const char *effect = effectNames[options.effect];
+
+	if(!drawn)
+	{
+		printf("format %d, x%d, %s, padding %d: frame not drawn\n", options.format, options.scale, effect, (int)padding);
+		failures++;
+	}
+
+	if(written > 0)
+	{
+		printf("format %d, x%d, %s, padding %d: %d bytes written outside frame\n", options.format, options.scale, effect, (int)padding, written);
+		failures++;
+	}
+
+	if(wrong > 0)
+	{
+		printf("format %d, x%d, %s, palette %d, padding %d, %d threads: %d wrong pixels\n", options.format, options.scale, effect, options.palette, (int)padding, options.threads, wrong);
+		failures++;
+	}
+
+	return failures;
+}
+
+int main()
+{
+	static const int formats[] = {VIDEO_FORMAT_0RGB1555, VIDEO_FORMAT_XRGB8888, VIDEO_FORMAT_RGB565};
+
+	VE_VMS_RAM ram;
+	ram.writeByte_RAW(MCR, 8);	//LCD on
+
+	//Lit and unlit pixels in every line, whole banks so the window may move
+	unsigned seed = 1;
+	for(int bank = 0; bank < 2; ++bank)
+	{
+		for(int i = 0; i < RAM_XRAM_ALLOCATED; ++i)
+		{
+			seed = seed * 1103515245 + 12345;
+			ram.getXRAM(bank)[i] = (byte)(seed >> 16);
+		}
+	}
+
+	VE_VMS_VIDEO video(&ram);
+	int failures = 0;
+
+	for(int start = 0; start <= 2; start += 2)
+	{
+		ram.writeByte_RAW(STAD, start);
+
+		for(int f = 0; f < 3; ++f)
+		{
+			for(int scale = 1; scale <= VIDEO_MAX_SCALE; ++scale)
+			{
+				for(int effect = VIDEO_EFFECT_NONE; effect <= VIDEO_EFFECT_DOTS; ++effect)
+				{
+					for(int palette = 0; palette < VIDEO_PALETTE_COUNT; ++palette)
+					{
+						for(int threads = 1; threads <= VIDEO_MAX_THREADS; threads += VIDEO_MAX_THREADS - 1)
+						{
+							VE_VMS_VIDEO_OPTIONS options;
+							options.format = formats[f];
+							options.scale = scale;
+							options.effect = effect;
+							options.palette = palette;
+							options.threads = threads;
+							video.setOptions(options);
+
+							for(size_t padding = 0; padding <= 16; padding += 16)
+								failures += checkFrame(&video, &ram, padding);
+						}
+					}
+				}
+			}
+		}
+	}
+
+#ifdef VE_VMS_VIDEO_SSE2
+	printf("video_test: %d failures\n", failures);
+#else
+	printf("video_test (Lookup table): %d failures\n", failures);
+#endif
+
+	return failures == 0 ? 0 : 1;
+}
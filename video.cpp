@@ -16,48 +16,308 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <string.h>
 #include "video.h"
 
+#ifdef VE_VMS_VIDEO_SSE2
+#include <emmintrin.h>
+#endif
+
+//On, off and grid color of each palette (0xRRGGBB)
+static const uint32_t palettes[VIDEO_PALETTE_COUNT][3] =
+{
+	{0x000000, 0xFFFFFF, 0xD8D8D8},
+	{0x1E2A1A, 0x9DB68A, 0x8CA37A},
+	{0x3C1E00, 0xF0A830, 0xD8942A},
+	{0xF0F8FF, 0x2050B0, 0x18409A}
+};
+
+#ifdef VE_VMS_VIDEO_SSE2
+//Expands one LCD line (MSB is leftmost pixel, set bit is a pixel turned on) into SCREEN_WIDTH pixels.
+//Byte is copied to 8 lanes, each lane tests its bit (Lane is all ones when bit is clear, which selects off color)
+static inline void expandLineSSE2(const byte *line, uint16_t *out, uint16_t on, uint16_t off)
+{
+	const __m128i bits = _mm_setr_epi16(0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i colorOn = _mm_set1_epi16((short)on);
+	const __m128i toOff = _mm_set1_epi16((short)(on ^ off));
+
+	for(int x = 0; x < LCD_LINE_BYTES; ++x)
+	{
+		__m128i off = _mm_cmpeq_epi16(_mm_and_si128(_mm_set1_epi16(line[x]), bits), zero);
+		_mm_storeu_si128((__m128i *)(out + 8*x), _mm_xor_si128(colorOn, _mm_and_si128(off, toOff)));
+	}
+}
+
+//Same with 4 lanes of 32-bit pixels, each byte makes 2 stores
+static inline void expandLineSSE2(const byte *line, uint32_t *out, uint32_t on, uint32_t off)
+{
+	const __m128i high = _mm_setr_epi32(0x80, 0x40, 0x20, 0x10);
+	const __m128i low = _mm_setr_epi32(0x08, 0x04, 0x02, 0x01);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i colorOn = _mm_set1_epi32((int)on);
+	const __m128i toOff = _mm_set1_epi32((int)(on ^ off));
+
+	for(int x = 0; x < LCD_LINE_BYTES; ++x)
+	{
+		__m128i b = _mm_set1_epi32(line[x]);
+		__m128i offHigh = _mm_cmpeq_epi32(_mm_and_si128(b, high), zero);
+		__m128i offLow = _mm_cmpeq_epi32(_mm_and_si128(b, low), zero);
+		_mm_storeu_si128((__m128i *)(out + 8*x), _mm_xor_si128(colorOn, _mm_and_si128(offHigh, toOff)));
+		_mm_storeu_si128((__m128i *)(out + 8*x + 4), _mm_xor_si128(colorOn, _mm_and_si128(offLow, toOff)));
+	}
+}
+#endif
+
+//LCD line y (0-31) in XRAM window
+static inline const byte *lineAddress(const byte *bank0, const byte *bank1, int y)
+{
+	int line = y % LCD_LINES_PER_BANK;
+
+	return ((y < LCD_LINES_PER_BANK) ? bank0 : bank1) + (line / 2) * 16 + (line % 2) * LCD_LINE_BYTES;
+}
+
 VE_VMS_VIDEO::VE_VMS_VIDEO(VE_VMS_RAM *_ram)
 {
 	ram = _ram;
+	drawnGeneration = ram->displayGeneration - 1;	//Nothing drawn yet
+
+#ifdef VE_VMS_VIDEO_THREADS
+	workerCount = 0;
+	pthread_mutex_init(&lock, NULL);
+	pthread_cond_init(&jobReady, NULL);
+	pthread_cond_init(&jobDone, NULL);
+	job = 0;
+	pending = 0;
+	stopping = false;
+	jobBuffer = NULL;
+	jobPitch = 0;
+#endif
+
+	VE_VMS_VIDEO_OPTIONS o;
+	o.format = VIDEO_FORMAT_RGB565;
+	o.scale = 1;
+	o.effect = VIDEO_EFFECT_NONE;
+	o.palette = VIDEO_PALETTE_WHITE;
+	o.threads = 1;
+	setOptions(o);
 }
 
 VE_VMS_VIDEO::~VE_VMS_VIDEO()
 {
+#ifdef VE_VMS_VIDEO_THREADS
+	stopWorkers();
+	pthread_mutex_destroy(&lock);
+	pthread_cond_destroy(&jobReady);
+	pthread_cond_destroy(&jobDone);
+#endif
+}
+
+///Selects pixel format, scale, cell style, palette and threads of drawn frames, next frame is drawn again
+void VE_VMS_VIDEO::setOptions(const VE_VMS_VIDEO_OPTIONS &o)
+{
+	options = o;
+	drawnGeneration = ram->displayGeneration - 1;
+
+	if(options.scale < 1) options.scale = 1;
+	if(options.scale > VIDEO_MAX_SCALE) options.scale = VIDEO_MAX_SCALE;
+	if(options.palette < 0 || options.palette >= VIDEO_PALETTE_COUNT) options.palette = VIDEO_PALETTE_WHITE;
+	if(options.threads < 1) options.threads = 1;
+	if(options.threads > VIDEO_MAX_THREADS) options.threads = VIDEO_MAX_THREADS;
+
+	switch(options.format)
+	{
+		case VIDEO_FORMAT_0RGB1555:
+			drawLines = &VE_VMS_VIDEO::drawLinesAs<VE_VMS_PIXEL_0RGB1555>;
+			prepareAs<VE_VMS_PIXEL_0RGB1555>();
+			break;
+		case VIDEO_FORMAT_XRGB8888:
+			drawLines = &VE_VMS_VIDEO::drawLinesAs<VE_VMS_PIXEL_XRGB8888>;
+			prepareAs<VE_VMS_PIXEL_XRGB8888>();
+			break;
+		default:
+			options.format = VIDEO_FORMAT_RGB565;
+			drawLines = &VE_VMS_VIDEO::drawLinesAs<VE_VMS_PIXEL_RGB565>;
+			prepareAs<VE_VMS_PIXEL_RGB565>();
+			break;
+	}
+
+#ifdef VE_VMS_VIDEO_THREADS
+	stopWorkers();
+	if(options.scale >= VIDEO_THREADED_SCALE) startWorkers(options.threads - 1);
+#endif
+}
+
+///Converts palette to Format and builds cell rows for scale and effect (And expansion table without SSE2)
+template<class Format>
+void VE_VMS_VIDEO::prepareAs()
+{
+	typedef typename Format::pixel pixel;
+
+	const uint32_t *palette = palettes[options.palette];
+	colorOn = Format::fromRGB(palette[0]);
+	colorOff = Format::fromRGB(palette[1]);
+	colorGrid = Format::fromRGB(palette[2]);
+
+	int s = options.scale;
+	int effect = (s >= 2) ? options.effect : VIDEO_EFFECT_NONE;
+	bool dots = effect == VIDEO_EFFECT_DOTS && s >= 4;
+
+	memset(cells, 0, sizeof(cells));
+
+	for(int k = 0; k < s; ++k)
+	{
+		cellRowChanges[k] = (k == 0);
+
+		for(int j = 0; j < s; ++j)
+		{
+			//Grid is at last row and column, dots also lose corners of what is left
+			bool grid = effect != VIDEO_EFFECT_NONE && (k == s - 1 || j == s - 1);
+			if(dots && (k == 0 || k == s - 2) && (j == 0 || j == s - 2)) grid = true;
+
+			((pixel *)cells[0][k])[j] = grid ? colorGrid : colorOff;
+			((pixel *)cells[1][k])[j] = grid ? colorGrid : colorOn;
+
+			if(k > 0 && ((pixel *)cells[1][k])[j] != ((pixel *)cells[1][k - 1])[j]) cellRowChanges[k] = true;
+			if(k > 0 && ((pixel *)cells[0][k])[j] != ((pixel *)cells[0][k - 1])[j]) cellRowChanges[k] = true;
+		}
+	}
+
+#ifndef VE_VMS_VIDEO_SSE2
+	for(int b = 0; b < 256; ++b)
+		for(int j = 0; j < 8; ++j)
+			((pixel *)expandTable[b])[j] = ((b & (0x80 >> j)) != 0) ? colorOn : colorOff;
+#endif
+}
+
+const VE_VMS_VIDEO_OPTIONS &VE_VMS_VIDEO::getOptions()
+{
+	return options;
+}
+
+int VE_VMS_VIDEO::getPixelFormat()
+{
+	return options.format;
+}
+
+size_t VE_VMS_VIDEO::getPixelSize()
+{
+	return (options.format == VIDEO_FORMAT_XRGB8888) ? 4 : 2;
+}
+
+unsigned VE_VMS_VIDEO::getWidth()
+{
+	return SCREEN_WIDTH * options.scale;
+}
+
+unsigned VE_VMS_VIDEO::getHeight()
+{
+	return SCREEN_HEIGHT * options.scale;
 }
 
-void VE_VMS_VIDEO::drawFrame(uint16_t *buffer)
+void VE_VMS_VIDEO::drawFrame(void *buffer, size_t pitch)
 {
-	//Read XRAM buffer from RAM (WRAM starts at 180), each 6 bytes make 1 horizontal line on-screen
+	//Read XRAM buffer from RAM (XRAM starts at 180), each 6 bytes make 1 horizontal line on-screen
 	//Each bit declares whether the pixel is on or off
 	//There is a 4-byte empty space between each two lines (96 bytes) of XRAM buffer.
 
 	if((ram->readByte_RAW(MCR) & 8) == 0)
 		return;
 
+	drawnGeneration = ram->displayGeneration;
+
+#ifdef VE_VMS_VIDEO_THREADS
+	if(workerCount > 0)
+	{
+		//Workers draw their shares while this thread draws the first one
+		pthread_mutex_lock(&lock);
+		jobBuffer = (byte *)buffer;
+		jobPitch = pitch;
+		pending = workerCount;
+		job++;
+		pthread_cond_broadcast(&jobReady);
+		pthread_mutex_unlock(&lock);
+
+		drawShare((byte *)buffer, pitch, 0);
+
+		pthread_mutex_lock(&lock);
+		while(pending > 0) pthread_cond_wait(&jobDone, &lock);
+		pthread_mutex_unlock(&lock);
+		return;
+	}
+#endif
+
+	(this->*drawLines)((byte *)buffer, pitch, 0, SCREEN_HEIGHT);
+}
+
+///Draws LCD lines first to last - 1 (Pixels of banks 0 and 1, window starts at STAD).
+///Scaled lines are built from cell rows, a cell row like the one above it is copied from the line drawn before.
+template<class Format>
+void VE_VMS_VIDEO::drawLinesAs(byte *buffer, size_t pitch, int first, int last)
+{
+	typedef typename Format::pixel pixel;
+
+	size_t start = ram->readByte_RAW(STAD);
+	const byte *bank0 = ram->getXRAM(0) + start;
+	const byte *bank1 = ram->getXRAM(1) + start;
+
+	int s = options.scale;
+	size_t cellBytes = s * sizeof(pixel);
+	size_t rowBytes = SCREEN_WIDTH * cellBytes;
+
+#ifdef VE_VMS_VIDEO_SSE2
+	//Cells whose 16-byte stores end inside the line
+	size_t storeBytes = (cellBytes + 15) & ~(size_t)15;
+	int wideCells = (int)((rowBytes - storeBytes) / cellBytes) + 1;
+#endif
+
+	buffer += first * s * pitch;
 
-	size_t XRAMAddress;
-	byte MSB = 0x80;	//10000000b
-	//Draw pixels (48x32) for banks 0 and 1 ("i" selects bank)
-	for(int i = 0, c = 0; i < 2; ++i) 
+	for(int y = first; y < last; ++y)
 	{
-		XRAMAddress = 0x180;
-		for (int y = 0; y < 16; y++) 
+		const byte *line = lineAddress(bank0, bank1, y);
+
+		if(s == 1)
+		{
+#ifdef VE_VMS_VIDEO_SSE2
+			expandLineSSE2(line, (pixel *)buffer, (pixel)colorOn, (pixel)colorOff);
+#else
+			for(int x = 0; x < LCD_LINE_BYTES; ++x)
+				memcpy(buffer + 8*x*sizeof(pixel), (const byte *)expandTable[line[x]], 8*sizeof(pixel));
+#endif
+			buffer += pitch;
+			continue;
+		}
+
+		for(int k = 0; k < s; ++k)
 		{
-			byte *pixelLine = new byte[6];
+			if(!cellRowChanges[k])
+			{
+				memcpy(buffer, buffer - pitch, rowBytes);
+				buffer += pitch;
+				continue;
+			}
 
-			if((y % 2 == 0) && (y > 0)) XRAMAddress += 4;
+			byte *out = buffer;
+			int x = 0;
 
-			for(int p = 0; p < 6; p++)
-				pixelLine[p] = ram->readByteXRAM(XRAMAddress++, i);
+#ifdef VE_VMS_VIDEO_SSE2
+			//Cells are stored in whole 16-byte blocks and the next cell overwrites what went past one,
+			//so this only goes on while the blocks stay inside the line
+			for(; x < wideCells; ++x, out += cellBytes)
+			{
+				const byte *cell = (const byte *)cells[(line[x >> 3] >> (7 - (x & 7))) & 1][k];
+				_mm_storeu_si128((__m128i *)out, _mm_loadu_si128((const __m128i *)cell));
+				if(cellBytes > 16) _mm_storeu_si128((__m128i *)(out + 16), _mm_loadu_si128((const __m128i *)(cell + 16)));
+				if(cellBytes > 32) _mm_storeu_si128((__m128i *)(out + 32), _mm_loadu_si128((const __m128i *)(cell + 32)));
+			}
+#endif
 
-			//Big-Endian
-			for (int x = 0; x < 6; x++)
-				for (int j = 0; j < 8; j++)
-					buffer[c++] = ((pixelLine[x] & (MSB >> j)) != 0) ? 0 : 0xFFFF;
-					
-			delete []pixelLine;
+			//Last cells are copied exactly, nothing past end of line is written
+			for(; x < SCREEN_WIDTH; ++x, out += cellBytes)
+				memcpy(out, (const byte *)cells[(line[x >> 3] >> (7 - (x & 7))) & 1][k], cellBytes);
+
+			buffer += pitch;
 		}
 	}
 
@@ -87,3 +347,80 @@ void VE_VMS_VIDEO::drawFrame(uint16_t *buffer)
 	}*/
 }
 
+bool VE_VMS_VIDEO::hasChanged()
+{
+	return drawnGeneration != ram->displayGeneration;
+}
+
+#ifdef VE_VMS_VIDEO_THREADS
+///Starts count workers (Fewer if threads can't be created)
+void VE_VMS_VIDEO::startWorkers(int count)
+{
+	stopping = false;
+
+	for(int i = 0; i < count; ++i)
+	{
+		VE_VMS_VIDEO_WORKER &worker = workers[workerCount];
+		worker.video = this;
+		worker.index = workerCount + 1;
+		worker.job = job;
+
+		if(pthread_create(&worker.thread, NULL, runWorker, &worker) != 0) break;
+		workerCount++;
+	}
+}
+
+void VE_VMS_VIDEO::stopWorkers()
+{
+	if(workerCount == 0) return;
+
+	pthread_mutex_lock(&lock);
+	stopping = true;
+	pthread_cond_broadcast(&jobReady);
+	pthread_mutex_unlock(&lock);
+
+	for(int i = 0; i < workerCount; ++i)
+		pthread_join(workers[i].thread, NULL);
+
+	workerCount = 0;
+}
+
+///Draws LCD lines of share index (Lines are split evenly between workerCount + 1 threads)
+void VE_VMS_VIDEO::drawShare(byte *buffer, size_t pitch, int index)
+{
+	int shares = workerCount + 1;
+	int first = SCREEN_HEIGHT * index / shares;
+	int last = SCREEN_HEIGHT * (index + 1) / shares;
+
+	(this->*drawLines)(buffer, pitch, first, last);
+}
+
+///Waits for frames and draws its share of each
+void *VE_VMS_VIDEO::runWorker(void *arg)
+{
+	VE_VMS_VIDEO_WORKER *worker = (VE_VMS_VIDEO_WORKER *)arg;
+	VE_VMS_VIDEO *video = worker->video;
+
+	pthread_mutex_lock(&video->lock);
+
+	for(;;)
+	{
+		while(video->job == worker->job && !video->stopping) pthread_cond_wait(&video->jobReady, &video->lock);
+		if(video->stopping) break;
+
+		worker->job = video->job;
+		byte *buffer = video->jobBuffer;
+		size_t pitch = video->jobPitch;
+		pthread_mutex_unlock(&video->lock);
+
+		video->drawShare(buffer, pitch, worker->index);
+
+		pthread_mutex_lock(&video->lock);
+		if(--video->pending == 0) pthread_cond_signal(&video->jobDone);
+	}
+
+	pthread_mutex_unlock(&video->lock);
+
+	return NULL;
+}
+#endif
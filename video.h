@@ -21,6 +21,101 @@
 
 #include "ram.h"
 
+//SSE2 (Always there on x86-64) expands LCD pixels, a lookup table is used elsewhere (Or with VE_VMS_VIDEO_NO_SSE2)
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(VE_VMS_VIDEO_NO_SSE2)
+#define VE_VMS_VIDEO_SSE2
+#endif
+
+//Scaled frames may be drawn by several threads
+#if defined(__unix__) || defined(__APPLE__)
+#define VE_VMS_VIDEO_THREADS
+#include <pthread.h>
+#endif
+
+//LCD in XRAM: 16 lines of 6 bytes in each of banks 0 and 1, every 2 lines are followed by 4 unused bytes
+#define LCD_LINE_BYTES 6
+#define LCD_LINES_PER_BANK 16
+
+//Output pixel formats (Same values as retro_pixel_format)
+#define VIDEO_FORMAT_0RGB1555 0
+#define VIDEO_FORMAT_XRGB8888 1
+#define VIDEO_FORMAT_RGB565 2
+
+//Integer scale of drawn frames (Each LCD pixel becomes a square cell)
+#define VIDEO_MAX_SCALE 10
+#define VIDEO_MAX_WIDTH (SCREEN_WIDTH * VIDEO_MAX_SCALE)
+#define VIDEO_MAX_HEIGHT (SCREEN_HEIGHT * VIDEO_MAX_SCALE)
+
+//Cell styles, gaps between cells show the grid color of palette
+#define VIDEO_EFFECT_NONE 0
+#define VIDEO_EFFECT_GRID 1     //1 pixel gap at right and bottom of each cell (Scale 2 and up)
+#define VIDEO_EFFECT_DOTS 2     //Grid with round dots (Corners of cells are cut, scale 4 and up)
+
+//LCD palettes
+#define VIDEO_PALETTE_WHITE 0   //Black on white
+#define VIDEO_PALETTE_GREEN 1   //Like VMU LCD
+#define VIDEO_PALETTE_AMBER 2
+#define VIDEO_PALETTE_BLUE 3    //Backlit, light pixels on blue
+#define VIDEO_PALETTE_COUNT 4
+
+//Scaled frames are split between threads from this scale on (Smaller ones are not worth waking them up)
+#define VIDEO_THREADED_SCALE 4
+#define VIDEO_MAX_THREADS 4
+
+//Pixel of each format and its conversion from 0xRRGGBB, drawing is compiled for each of them
+struct VE_VMS_PIXEL_0RGB1555
+{
+    typedef uint16_t pixel;
+
+    static pixel fromRGB(uint32_t rgb)
+    {
+        return ((rgb >> 9) & 0x7C00) | ((rgb >> 6) & 0x03E0) | ((rgb >> 3) & 0x001F);
+    }
+};
+
+struct VE_VMS_PIXEL_XRGB8888
+{
+    typedef uint32_t pixel;
+
+    static pixel fromRGB(uint32_t rgb)
+    {
+        return rgb & 0x00FFFFFF;
+    }
+};
+
+struct VE_VMS_PIXEL_RGB565
+{
+    typedef uint16_t pixel;
+
+    static pixel fromRGB(uint32_t rgb)
+    {
+        return ((rgb >> 8) & 0xF800) | ((rgb >> 5) & 0x07E0) | ((rgb >> 3) & 0x001F);
+    }
+};
+
+//How frames are drawn (Chosen by frontend options when a game is loaded)
+struct VE_VMS_VIDEO_OPTIONS
+{
+    int format;         //VIDEO_FORMAT_*
+    int scale;          //1 to VIDEO_MAX_SCALE
+    int effect;         //VIDEO_EFFECT_*
+    int palette;        //VIDEO_PALETTE_*
+    int threads;        //1 to VIDEO_MAX_THREADS
+};
+
+class VE_VMS_VIDEO;
+
+#ifdef VE_VMS_VIDEO_THREADS
+//Thread drawing a share of LCD lines of each scaled frame
+struct VE_VMS_VIDEO_WORKER
+{
+    VE_VMS_VIDEO *video;
+    int index;          //Share drawn (0 is drawFrame's own)
+    unsigned job;       //Last frame drawn
+    pthread_t thread;
+};
+#endif
+
 ///This keeps track of XRAM and draws on the canvas when refresh rate occurs.
 class VE_VMS_VIDEO
 {
@@ -28,11 +123,79 @@ public:
     VE_VMS_VIDEO(VE_VMS_RAM *_ram);
     ~VE_VMS_VIDEO();
 
-    void drawFrame(uint16_t *buffer);
+    //Draws LCD into buffer (getWidth x getHeight in selected pixel format), pitch is number of bytes between starts of two lines
+    void drawFrame(void *buffer, size_t pitch);
+
+    //Selects pixel format, scale, cell style, palette and threads of drawn frames (RGB565, black on white at 1x by default)
+    void setOptions(const VE_VMS_VIDEO_OPTIONS &o);
+
+    const VE_VMS_VIDEO_OPTIONS &getOptions();
+
+    int getPixelFormat();
+
+    //Bytes per pixel of selected format
+    size_t getPixelSize();
+
+    //Size of drawn frames
+    unsigned getWidth();
+    unsigned getHeight();
+
+    //Whether LCD changed since last drawFrame (Otherwise buffer already holds it)
+    bool hasChanged();
     
 private:
 	VE_VMS_RAM *ram;
 
+	unsigned drawnGeneration;	//RAM display generation of last drawn frame
+
+	VE_VMS_VIDEO_OPTIONS options;
+
+	//Palette in selected format (Stored in low bits for 16-bit formats)
+	uint32_t colorOn;
+	uint32_t colorOff;
+	uint32_t colorGrid;
+
+	//Rows of a cell when its pixel is off (0) or on (1) in selected format, each row is padded to whole 16-byte stores
+	uint32_t cells[2][VIDEO_MAX_SCALE][12];
+
+	//Whether cell row differs from the one above it (Otherwise it is copied)
+	bool cellRowChanges[VIDEO_MAX_SCALE];
+
+#ifndef VE_VMS_VIDEO_SSE2
+	//8 pixels of each byte value in selected format
+	uint32_t expandTable[256][8];
+#endif
+
+	//Line drawing compiled for selected pixel format, picked by setOptions
+	void (VE_VMS_VIDEO::*drawLines)(byte *buffer, size_t pitch, int first, int last);
+
+	template<class Format> void prepareAs();
+
+	//Draws LCD lines first to last - 1
+	template<class Format> void drawLinesAs(byte *buffer, size_t pitch, int first, int last);
+
+#ifdef VE_VMS_VIDEO_THREADS
+	VE_VMS_VIDEO_WORKER workers[VIDEO_MAX_THREADS - 1];
+	int workerCount;
+
+	pthread_mutex_t lock;
+	pthread_cond_t jobReady;
+	pthread_cond_t jobDone;
+	unsigned job;               //Incremented for each frame given to workers
+	int pending;                //Workers still drawing it
+	bool stopping;
+	byte *jobBuffer;
+	size_t jobPitch;
+
+	void startWorkers(int count);
+	void stopWorkers();
+
+	//Draws LCD lines of share index (Of workerCount + 1)
+	void drawShare(byte *buffer, size_t pitch, int index);
+
+	static void *runWorker(void *arg);
+#endif
+
 	//BIOS icons
 	/*static int FILE_ICON[] = {
             0x00, 0x00, 0x00,
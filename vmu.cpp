@@ -16,37 +16,44 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <string.h>
 #include "vmu.h"
+#include "log.h"
 
-VMU::VMU(uint16_t *_frameBuffer)
+VMU::VMU()
 {
 	//Initialize system
 	ram = new VE_VMS_RAM();
-	rom = new VE_VMS_ROM();
-	flash = new VE_VMS_FLASH(ram);
+	icache = new VE_VMS_ICACHE();
+	rom = new VE_VMS_ROM(icache);
+	flash = new VE_VMS_FLASH(ram, icache);
 	intHandler = new VE_VMS_INTERRUPTS();
+	busyLoops = new VE_VMS_BUSYLOOPS();
 	
-	cpu = new VE_VMS_CPU(ram, rom, flash, intHandler, true);
+	cpu = new VE_VMS_CPU(ram, rom, flash, intHandler, icache, busyLoops);
+	clock = new VE_VMS_CLOCK();
 	
-	audio = new VE_VMS_AUDIO(cpu, ram);
+	audio = new VE_VMS_AUDIO(clock, ram);
 	
-	t0 = new VE_VMS_TIMER0(ram, intHandler, cpu, &prescaler);
+	t0 = new VE_VMS_TIMER0(ram, intHandler, cpu);
 	t1 = new VE_VMS_TIMER1(ram, intHandler, audio);
-	baseTimer = new VE_VMS_BASETIMER(ram, intHandler, cpu);
+	baseTimer = new VE_VMS_BASETIMER(ram, intHandler, clock);
+	
+	scheduler = new VE_VMS_SCHEDULER(t0, t1, baseTimer);
+	ram->scheduler = scheduler;
+	observeSFR();
 	
 	video = new VE_VMS_VIDEO(ram);
-	frameBuffer = _frameBuffer;
 	
 	
 	//Initialize variables
-	ccount = 0;  //Cycle count
-    cycle_count = 0;
+    rtcRemainder = 0;
+    memset(&frameStats, 0, sizeof(frameStats));
+    memset(&totalStats, 0, sizeof(totalStats));
+    frames = 0;
     time_reg = 0;
     frame_skip = 0;
     CPS = 0; //Real cycles per second
-    prescaler = 0;
-    pcount = 0;
-    oldPRR = -1;
 
     OSC = 0;
     OCR_old = -1; //For performance, not to calculate clock each time, unless OCR is changed.
@@ -55,21 +62,29 @@ VMU::VMU(uint16_t *_frameBuffer)
     BIOSExists = false;
     enableSound = true;
     useT1ELD = false; //Some mini-game programmers (Especially homebrew creators) don't use it
-    cycles_left = 0;
+    engine = VMU_ENGINE_INTERPRETER;
+    traceInstructions = false;
+    jit = NULL;
+    selectRunLoop();
 }
 
 VMU::~VMU()
 {
+	delete jit;
 	delete t0;
 	delete t1;
 	delete baseTimer;
+	delete scheduler;
 	delete audio;
 	delete video;
 	delete flash;
 	delete cpu;
+	delete clock;
 	delete intHandler;
 	delete ram;
 	delete rom;
+	delete icache;
+	delete busyLoops;
 }
 
 int VMU::loadBIOS(const char *filePath)
@@ -82,11 +97,15 @@ int VMU::loadBIOS(const char *filePath)
 	size_t fileSize = ftell(bios);
 	fseek(bios, 0, SEEK_SET);
 
-	byte *BIOS_Data_Encrypted = new byte[0xF004];
+	if(fileSize > 0xF004)
+	{
+		fclose(bios);
+		return -2; //Unknown BIOS image type
+	}
+
+	byte *BIOS_Data_Encrypted = new byte[0xF004]();	//Zeroed, file may be shorter
 	byte *BIOS_Data = new byte[0xF000];
-	
-	if(fileSize > 0xF004) return -2; //Unknown BIOS image type
-	
+
 	
 	for(size_t i = 0; i < fileSize; ++i)
 		BIOS_Data_Encrypted[i] = fgetc(bios);
@@ -118,14 +137,18 @@ int VMU::loadBIOS(const char *filePath)
 
 	//Check BIOS one last time (After decrypting)
 	if(BIOS_Data[0] != 0x2A)
+	{
+		delete []BIOS_Data;
+		delete []BIOS_Data_Encrypted;
 		return -1;
+	}
 
 	BIOSExists = true;
 
-	//This is loaded in (64KB) of ROM
-	for(size_t i = 0; i < 0xF000; ++i)
-		rom->writeByte(i, BIOS_Data[i]);
-		
+	//This is loaded in (64KB) of ROM, instances with the same BIOS share one image
+	rom->loadData(BIOS_Data, 0xF000);
+	ram->setCodeMemory(rom->getData(), flash->getRawData());
+
 	delete []BIOS_Data;
 	delete []BIOS_Data_Encrypted;
 
@@ -195,13 +218,19 @@ void VMU::startCPU()
 	if(!BIOSExists)
 	{
 		//Enable HLE
-		ram->writeByte_RAW(EXT, 1);
+		ram->writeByte(EXT, 1);
 		cpu->EXTOld = 1;
 		initializeHLE();
 	} else initBIOS();
 
 	cpu->state = 1;
 
+	//Date is set once BIOS has initialized memory
+	if(BIOSExists) scheduler->schedule(SCHED_RTC, RTC_FIRST_UPDATE);
+
+	//System software is known now
+	selectRunLoop();
+
 	//if(enableSound)
 		//audioThread.start();
 }
@@ -224,133 +253,287 @@ void VMU::initializeHLE()
 	ram->writeByte_RAW(BTCR, 0x41);
 }
 
-void VMU::runCycle() 
+///Runs CPU and handles events until cycles have passed. Timers are advanced only when an event is due
+///or software accesses their SFRs, which gives the same result as running them every cycle.
+void VMU::run(int cycles)
 {
-	//Calculate cpu clock frequency (Only when OCR is changed)
-	byte OCR_data = ram->readByte_RAW(OCR);
-	if (OCR_data != OCR_old) 
+	//Frontend and initialization write RAM directly, software writes are seen by sfrWritten
+	updateSFR();
+
+	scheduler->beginFrame(cycles);
+
+	//Last instruction of previous frame may have run past its end, those cycles are already spent
+	int start = scheduler->now;
+	int startInstructions = cpu->getInstructionCount();
+	memset(&frameStats, 0, sizeof(frameStats));
+
+	for(;;)
 	{
-		int freqDiv = 12;
-		if ((OCR_data & 128) != 0) freqDiv = 6;
-		OSC = 0;    //Main clock by default is RC
-		if ((OCR_data & 32) != 0) OSC = 1; //Quartz
-		//double freq;
-		if (OSC == 0) 
-		{
-			//freq = 879.236 / freqDiv;
-			audio->setAudioFrequency(600000 / freqDiv);   //What the real frequency should be
-			cpu->setFrequency(600000 / freqDiv);
-		} 
-		else    //RC
+		(this->*runLoop)();
+
+		//Timers raise interrupts that are due
+		scheduler->sync();
+
+		if(scheduler->due(SCHED_FRAME)) break;
+
+		//Refresh VMU date (Keeps up with host clock)
+		if(scheduler->due(SCHED_RTC))
 		{
-			//freq = 32.768 / freqDiv;
-			audio->setAudioFrequency(32768 / freqDiv);   //What the real frequency should be
-			cpu->setFrequency(32768 / freqDiv);
+			setDate();
+			scheduler->schedule(SCHED_RTC, scheduler->now + clock->cycles(CLOCK_MASTER_RATE, rtcRemainder));
 		}
-		//double clock = (1.00 / freq) * 1000;    //In milliseconds
-		//cpu->clock = (int) clock;//(int) clock;
 
+		scheduler->reschedule();
 	}
-	OCR_old = OCR_data;
 
-	//int cyclesUsed = 1;
+	frameStats.instructions = (unsigned)(cpu->getInstructionCount() - startInstructions);
+	frameStats.cycles = scheduler->now - start;
 
-	//Set T1LC and T1HC when bit 4 of T1CNT is 1
-	byte T1CNT_data = ram->readByte_RAW(T1CNT);
-	bool T1CUpdate = (T1CNT_data & 16) != 0;
-	if(T1CUpdate)
+	totalStats.instructions += frameStats.instructions;
+	totalStats.cycles += frameStats.cycles;
+	totalStats.interrupts += frameStats.interrupts;
+	totalStats.idleCycles += frameStats.idleCycles;
+	frames++;
+}
+
+///One instruction at a time, its cycles are spent at once
+template<class System, class Trace>
+void VMU::runInstructions()
+{
+	while(scheduler->now < scheduler->next)
 	{
-		ram->writeByte_RAW(T1LC, ram->T1LC_Temp);
-		ram->writeByte_RAW(T1HC, ram->T1HC_Temp);
+		byte PCON_data = ram->readByte_RAW(PCON);
 
-		audio->setT1C(ram->T1LC_Temp);
-	}
+		//Execute
+		int cycles = 0;
+		if (cpu->state != 0) 
+		{
+			if(cpu->processInterrupts()) frameStats.interrupts++;
+			if (PCON_data == 0) cycles = cpu->processInstruction<System, Trace>();
+		}
 
-	//Battery not low
-	ram->writeByte_RAW(0x31, 0xFF);
-	ram->writeByte_RAW(P7, 2);
+		if(cpu->state == 0 || (PCON_data != 0 && ram->readByte_RAW(PCON) != 0)) sleep();
+		else if(cycles != 0) scheduler->now += cycles;
+		else scheduler->now++;     //Woken up by an interrupt
 
-	byte PCON_data = ram->readByte_RAW(PCON);
+		if(cpu->spinning != NULL) skipBusyLoop();
+	}
+}
 
-	//Execute
-	if (cpu->state != 0) 
+///Runs superblocks instead of single instructions (Timers see a block as one point in time).
+///Blocks end at the next event, like single instructions the last one may end after it.
+template<class System, class Trace, class Blocks>
+void VMU::runBlocks()
+{
+	while(scheduler->now < scheduler->next)
 	{
-		cpu->processInterrupts();
-		if (PCON_data == 0) cycles_left = cpu->processInstruction(false);
+		byte PCON_data = ram->readByte_RAW(PCON);
+
+		//Execute
+		int cycles = 0;
+		if (cpu->state != 0) 
+		{
+			if(cpu->processInterrupts()) frameStats.interrupts++;
+			if (PCON_data == 0)
+			{
+				int maxCycles = scheduler->next - scheduler->now;
+
+				if(Blocks::native)
+				{
+					//Snapshot taken for verification must include timers
+					if(Blocks::verify) scheduler->sync();
+					cycles = jit->run<System>(maxCycles);
+				}
+				else cycles = cpu->runBlock<System, Trace>(maxCycles);
+			}
+		}
+
+		if(cycles != 0) scheduler->now += cycles;
+		else if(cpu->state == 0 || ram->readByte_RAW(PCON) != 0) sleep();
+		else scheduler->now++;     //Woken up by an interrupt
+
+		if(cpu->spinning != NULL) skipBusyLoop();
 	}
-	--cycles_left;
+}
+
+///Halted CPU does nothing until an event raises an interrupt (Or the frame ends), skips straight to it.
+///Stopped CPU (HLE exit) is never woken up, so the rest of the frame is skipped.
+void VMU::sleep()
+{
+	int end = (cpu->state == 0) ? scheduler->getEvent(SCHED_FRAME) : scheduler->next;
 
-	//Set prescaler
-	byte PRR = ram->readByte_RAW(T0PRR);
+	frameStats.idleCycles += end - scheduler->now;
+	scheduler->now = end;
+}
 
-	//This is important since Base Timer interrupts sometimes manipulates PRR, so we reset it so the modulo would be 0 in case number came.
-	if (PRR != oldPRR) 
-		pcount = PRR;
-		
-	if (pcount / 256 == 1) 
+///CPU is at the head of a loop that only polls memory, and its last iteration left CPU state unchanged.
+///Polled memory stays as that iteration read it until an event (Interrupts and frame input) or until the
+///timer SFR it reads counts, so every whole iteration before then is skipped.
+void VMU::skipBusyLoop()
+{
+	VE_VMS_BUSYLOOP *loop = cpu->spinning;
+	cpu->spinning = NULL;
+
+	//Waiting interrupt is taken in next cycle
+	if(intHandler->hasPending() || cpu->state == 0 || ram->readByte_RAW(PCON) != 0) return;
+
+	int now = scheduler->now;
+	int end = scheduler->next;
+
+	//Timers were synced when the loop read them (Not since)
+	for(int i = 0; i < loop->readCount; ++i)
 	{
-		prescaler = 1;
-		pcount = PRR;
-	} 
-	else 
+		int change = scheduler->nextChange(loop->reads[i]);
+		if(change < end) end = change;
+	}
+
+	int cycles = (end - now) / loop->period * loop->period;
+	if(cycles <= 0) return;
+
+	scheduler->now += cycles;
+	frameStats.idleCycles += cycles;
+
+	loop->hits++;
+	loop->cycles += cycles;
+	busyLoops->stats.hits++;
+	busyLoops->stats.cycles += cycles;
+}
+
+///Registers SFR side effects with RAM, T0PRR needs none since T0 is synced on every write to it
+void VMU::observeSFR()
+{
+	ram->setObserver(OCR, this);
+	ram->setObserver(T1CNT, this);
+	ram->setObserver(T1LC, this);
+	ram->setObserver(T1HC, this);
+	ram->setObserver(0x31, this);
+	ram->setObserver(P7, this);
+}
+
+///Clock (OCR), T1 compare latch and battery state, run when software writes them
+void VMU::sfrWritten(size_t address, byte value)
+{
+	switch(address)
 	{
-		prescaler = 0;
-		pcount++;
+		case OCR:
+			updateClock();
+			break;
+		case T1CNT:
+		case T1LC:
+		case T1HC:
+			latchT1Compare();
+			break;
+		//Battery not low
+		case 0x31:
+			ram->writeByte_RAW(0x31, 0xFF);
+			break;
+		case P7:
+			ram->writeByte_RAW(P7, 2);
+			break;
 	}
-	oldPRR = PRR;
+}
+
+///Applies all SFR side effects, for state written without going through RAM (Initialization, frontend)
+void VMU::updateSFR()
+{
+	ram->updateBanks();
+	updateClock();
+	latchT1Compare();
+
+	//Battery not low
+	ram->writeByte_RAW(0x31, 0xFF);
+	ram->writeByte_RAW(P7, 2);
+}
+
+///Calculates cpu clock frequency (Only when OCR is changed)
+void VMU::updateClock()
+{
+	byte OCR_data = ram->readByte_RAW(OCR);
+	if (OCR_data != OCR_old) 
+	{
+		int freqDiv = CLOCK_DIV_SLOW;
+		if ((OCR_data & 128) != 0) freqDiv = CLOCK_DIV_FAST;
+		OSC = 0;    //Main clock by default is RC
+		if ((OCR_data & 32) != 0) OSC = 1; //Quartz
 
+		//Base timer has counted at the old clock until now
+		scheduler->sync();
 
-	//Run timers (t0 and t1)
-	t0->runTimer();
-	t1->runTimer();
-	baseTimer->runTimer();
+		if (OSC == 0) clock->setSource(CLOCK_RC, freqDiv);
+		else clock->setSource(CLOCK_QUARTZ, freqDiv);
 
-	//Set VMU date (I just randomly put it at 10000, that is, till the BIOS has fully initialized memory, so it wont manipulate date value)
-	if (ccount == 10000 && BIOSExists) 
-		setDate();
-	else ccount++;
+		scheduler->reschedule();
+	}
+	OCR_old = OCR_data;
+}
+
+///Sets T1LC and T1HC when bit 4 of T1CNT is 1
+void VMU::latchT1Compare()
+{
+	byte T1CNT_data = ram->readByte_RAW(T1CNT);
+	bool T1CUpdate = (T1CNT_data & 16) != 0;
+	if(T1CUpdate)
+	{
+		ram->writeByte_RAW(T1LC, ram->T1LC_Temp);
+		ram->writeByte_RAW(T1HC, ram->T1HC_Temp);
 
-	cycle_count++;
+		audio->setT1C(ram->T1LC_Temp);
+	}
 }
 
 void VMU::reset()
 {
+	VE_VMS_VIDEO_OPTIONS videoOptions = video->getOptions();
+
+	delete jit;
+	jit = NULL;
 	delete t0;
 	delete t1;
 	delete baseTimer;
+	delete scheduler;
 	delete audio;
 	delete video;
 	delete flash;
 	delete cpu;
+	delete clock;
 	delete intHandler;
 	delete ram;
 	delete rom;
+	delete icache;
+	delete busyLoops;
 	
 	//Re-initialize system
 	ram = new VE_VMS_RAM();
-	rom = new VE_VMS_ROM();
-	flash = new VE_VMS_FLASH(ram);
+	icache = new VE_VMS_ICACHE();
+	rom = new VE_VMS_ROM(icache);
+	flash = new VE_VMS_FLASH(ram, icache);
 	intHandler = new VE_VMS_INTERRUPTS();
+	busyLoops = new VE_VMS_BUSYLOOPS();
 	
-	cpu = new VE_VMS_CPU(ram, rom, flash, intHandler, true);
+	cpu = new VE_VMS_CPU(ram, rom, flash, intHandler, icache, busyLoops);
+	clock = new VE_VMS_CLOCK();
 	
-	audio = new VE_VMS_AUDIO(cpu, ram);
+	audio = new VE_VMS_AUDIO(clock, ram);
 	
-	t0 = new VE_VMS_TIMER0(ram, intHandler, cpu, &prescaler);
+	t0 = new VE_VMS_TIMER0(ram, intHandler, cpu);
 	t1 = new VE_VMS_TIMER1(ram, intHandler, audio);
-	baseTimer = new VE_VMS_BASETIMER(ram, intHandler, cpu);
+	baseTimer = new VE_VMS_BASETIMER(ram, intHandler, clock);
+	
+	scheduler = new VE_VMS_SCHEDULER(t0, t1, baseTimer);
+	ram->scheduler = scheduler;
+	observeSFR();
 	
 	video = new VE_VMS_VIDEO(ram);
+	video->setOptions(videoOptions);     //Frontend was told about format and geometry when game was loaded
 	
 	//Re-nitialize variables
-	ccount = 0;  //Cycle count
-    cycle_count = 0;
+    rtcRemainder = 0;
+    memset(&frameStats, 0, sizeof(frameStats));
+    memset(&totalStats, 0, sizeof(totalStats));
+    frames = 0;
     time_reg = 0;
     frame_skip = 0;
     CPS = 0; //Real cycles per second
-    prescaler = 0;
-    pcount = 0;
-    oldPRR = -1;
 
     OSC = 0;
     OCR_old = -1; //For performance, not to calculate clock each time, unless OCR is changed.
@@ -359,5 +542,69 @@ void VMU::reset()
     BIOSExists = false;
     enableSound = true;
     useT1ELD = false; //Some mini-game programmers (Especially homebrew creators) don't use it
-    cycles_left = 0;
+    
+    //Engine is kept, bind it to the new CPU
+    setEngine(engine, traceInstructions);
+}
+
+///Selects CPU engine (VMU_ENGINE_*) and whether interpreted instructions are traced (Native code is never traced)
+void VMU::setEngine(int e, bool trace)
+{
+	engine = e;
+	traceInstructions = trace;
+
+	delete jit;
+	jit = NULL;
+
+	if(engine == VMU_ENGINE_JIT || engine == VMU_ENGINE_JIT_VERIFY)
+		jit = new VE_VMS_JIT(cpu, ram, icache, engine == VMU_ENGINE_JIT_VERIFY);
+
+	selectRunLoop();
+}
+
+///Picks run loop compiled for current engine, trace and system software, so running CPU tests none of them
+void VMU::selectRunLoop()
+{
+	if(BIOSExists) selectRunLoopFor<VE_VMS_BIOS>();
+	else selectRunLoopFor<VE_VMS_HLE>();
+}
+
+template<class System>
+void VMU::selectRunLoopFor()
+{
+	switch(engine)
+	{
+		case VMU_ENGINE_SUPERBLOCK:
+			if(traceInstructions) runLoop = &VMU::runBlocks<System, VE_VMS_TRACE_ON, VE_VMS_BLOCKS_INTERPRETED>;
+			else runLoop = &VMU::runBlocks<System, VE_VMS_TRACE_OFF, VE_VMS_BLOCKS_INTERPRETED>;
+			break;
+		case VMU_ENGINE_JIT:
+			runLoop = &VMU::runBlocks<System, VE_VMS_TRACE_OFF, VE_VMS_BLOCKS_NATIVE>;
+			break;
+		case VMU_ENGINE_JIT_VERIFY:
+			runLoop = &VMU::runBlocks<System, VE_VMS_TRACE_OFF, VE_VMS_BLOCKS_VERIFIED>;
+			break;
+		default:
+			if(traceInstructions) runLoop = &VMU::runInstructions<System, VE_VMS_TRACE_ON>;
+			else runLoop = &VMU::runInstructions<System, VE_VMS_TRACE_OFF>;
+			break;
+	}
+}
+
+///Logs statistics of CPU engines (Busy-wait loops skipped, blocks run) at debug level
+void VMU::logEngineStats()
+{
+	if(frames != 0)
+	{
+		LOG_print(LOG_LEVEL_DEBUG, "Frames: %lu, per frame %.1f instructions, %.1f cycles (%.1f idle), %.2f interrupts", frames,
+			(double)totalStats.instructions / frames, (double)totalStats.cycles / frames,
+			(double)totalStats.idleCycles / frames, (double)totalStats.interrupts / frames);
+	}
+
+	busyLoops->logStats();
+
+	if(engine == VMU_ENGINE_INTERPRETER) return;
+
+	cpu->logBlockStats();
+	if(jit != NULL) jit->logStats();
 }
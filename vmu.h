@@ -26,27 +26,53 @@
 #include "video.h"
 #include "rom.h"
 #include "audio.h"
+#include "clock.h"
 #include "t0.h"
 #include "t1.h"
 #include "basetimer.h"
+#include "scheduler.h"
+#include "jit.h"
 #include "interrupts.h"
 #include "bitwisemath.h"
 
-class VMU
+//CPU engines (Chosen once when a game is loaded)
+#define VMU_ENGINE_INTERPRETER 0
+#define VMU_ENGINE_SUPERBLOCK 1
+#define VMU_ENGINE_JIT 2
+#define VMU_ENGINE_JIT_VERIFY 3     //JIT checked against the interpreter
+
+//What ran in a frame (Or in all frames so far)
+struct VE_VMS_FRAME_STATS
+{
+    unsigned long instructions;
+    unsigned long cycles;           //Including idle cycles
+    unsigned long interrupts;       //Interrupts taken
+    unsigned long idleCycles;       //Skipped while CPU was halted, stopped or spinning in a busy-wait loop
+};
+
+//Cycle of first date update with a BIOS (Memory is initialized by then), then once per second
+#define RTC_FIRST_UPDATE 10001
+
+class VMU : public VE_VMS_SFR_OBSERVER
 {
 public:
 	VE_VMS_RAM *ram;
 	VE_VMS_ROM *rom;
 	VE_VMS_FLASH *flash;
 	VE_VMS_CPU *cpu;
+	VE_VMS_CLOCK *clock;
 	VE_VMS_TIMER0 *t0;
 	VE_VMS_TIMER1 *t1;
 	VE_VMS_BASETIMER *baseTimer;
+	VE_VMS_SCHEDULER *scheduler;
 	VE_VMS_INTERRUPTS *intHandler;
 	VE_VMS_VIDEO *video;
 	VE_VMS_AUDIO *audio;
+	VE_VMS_ICACHE *icache;
+	VE_VMS_BUSYLOOPS *busyLoops;
+	VE_VMS_JIT *jit;            //Only when a JIT engine is selected
 
-    VMU(uint16_t *_frameBuffer);
+    VMU();
     
     ~VMU();
     
@@ -64,19 +90,62 @@ public:
 
     void initializeHLE();
 
-    void runCycle();
+    //Runs system for a number of cycles
+    void run(int cycles);
     
     void reset();
+
+    ///Selects CPU engine (VMU_ENGINE_*) and whether interpreted instructions are traced
+    void setEngine(int e, bool trace);
+
+    ///Logs statistics of CPU engines (Busy-wait loops skipped, blocks run) and averages of frames
+    void logEngineStats();
+
+    VE_VMS_FRAME_STATS frameStats;     //Last frame
+    VE_VMS_FRAME_STATS totalStats;     //All frames since reset
+    unsigned long frames;
+
+    //Clock (OCR), T1 compare latch and battery state, run when software writes them
+    void sfrWritten(size_t address, byte value);
+
+    int engine;
+    bool traceInstructions;
     
 private:
-    int ccount;
-    long cycle_count;
+    //CPU loop compiled for the engine, system software (HLE or BIOS) and trace selected, picked by selectRunLoop
+    void (VMU::*runLoop)();
+
+    void selectRunLoop();
+
+    template<class System> void selectRunLoopFor();
+
+    //Registers SFR side effects with RAM
+    void observeSFR();
+
+    //Applies all SFR side effects, for state written without going through RAM (Initialization, frontend)
+    void updateSFR();
+
+    //Selects CPU clock from OCR (Only when it changed)
+    void updateClock();
+
+    //Copies T1LC and T1HC from their latches while bit 4 of T1CNT is set
+    void latchT1Compare();
+
+    //Run CPU until next scheduled event (Policies are in policy.h)
+    template<class System, class Trace> void runInstructions();
+    template<class System, class Trace, class Blocks> void runBlocks();
+
+    //Skips cycles of halted or stopped CPU
+    void sleep();
+
+    //Skips iterations of a busy-wait loop
+    void skipBusyLoop();
+
+    uint32_t rtcRemainder;     //Ticks of RTC second not yet scheduled
+
     long time_reg;
     long frame_skip;
     double CPS;
-    byte prescaler;
-    int pcount;
-    int oldPRR;
 
     int OSC;
     int OCR_old;
@@ -85,10 +154,6 @@ private:
     bool BIOSExists;
     bool enableSound;
     bool useT1ELD;
-    
-    int cycles_left; //This counts how many cycles an instruction has, and gets decreased each cycle. Next instruction is processed when it gets 0.
-    
-    uint16_t *frameBuffer;
 };
 
 #endif // _VMU_H_